@@ -0,0 +1,201 @@
+#include "CorpusGenerator.h"
+
+#include <fstream>
+#include <algorithm>
+
+namespace codeguard
+{
+// splitmix64; std:: distributions are implementation-defined, so the corpus would differ between toolchains.
+class CorpusRng final
+{
+public:
+    explicit CorpusRng(uint64_t seed)
+    {
+        state = seed;
+    }
+
+    uint64_t Next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t Below(uint64_t n)
+    {
+        return (n == 0) ? 0 : Next() % n;
+    }
+
+    double Unit()
+    {
+        return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    bool Chance(double p)
+    {
+        return Unit() < p;
+    }
+
+private:
+    uint64_t state;
+};
+
+static const char* const kBannedCalls[] = {
+    "gets(buf);",
+    "strcpy(buf, src);",
+    "strcat(buf, src);",
+    "sprintf(buf, \"%d\", n);",
+    "vsprintf(buf, fmt, ap);",
+    "system(cmd);",
+    "popen(cmd, \"r\");"
+};
+
+static const char* const kDecoyComments[] = {
+    "// do not use strcpy(buf, src) here",
+    "/* gets(buf) was removed */",
+    "// scanf(\"%s\", buf) is unsafe",
+    "/* system(cmd); popen(cmd, \"r\"); */"
+};
+
+static const char* const kDecoyStrings[] = {
+    "const char* s = \"strcpy(buf, src)\";",
+    "const char* s = \"scanf(\\\"%s\\\", buf)\";",
+    "puts(\"call gets(buf) never\");",
+    "const char* s = \"system(cmd) /* not a comment */\";"
+};
+
+static size_t PickFileSize(CorpusRng& rng, const CorpusOptions& opt)
+{
+    // Mostly around the mean, with a 2% tail of large files up to max_file_bytes.
+    if (rng.Chance(0.02))
+    {
+        return opt.mean_file_bytes + static_cast<size_t>(rng.Unit() * static_cast<double>(opt.max_file_bytes - std::min(opt.max_file_bytes, opt.mean_file_bytes)));
+    }
+    const double u = rng.Unit();
+    return std::max<size_t>(64, static_cast<size_t>(static_cast<double>(opt.mean_file_bytes) * (0.25 + 1.5 * u)));
+}
+
+static std::filesystem::path PickDirectory(CorpusRng& rng, const CorpusOptions& opt)
+{
+    std::filesystem::path dir;
+    const uint64_t depth = rng.Below(static_cast<uint64_t>(opt.max_depth) + 1);
+    for (uint64_t d = 0; d < depth; d++)
+    {
+        dir /= "d" + std::to_string(rng.Below(std::max<uint32_t>(1, opt.dirs_per_level)));
+    }
+    return dir;
+}
+
+CorpusOptions DefaultCorpusOptions()
+{
+    CorpusOptions opt;
+    opt.seed = 1;
+    opt.file_count = 1000;
+    opt.max_depth = 4;
+    opt.dirs_per_level = 8;
+    opt.mean_file_bytes = 8 * 1024;
+    opt.max_file_bytes = 512 * 1024;
+    opt.comment_density = 0.2;
+    opt.string_density = 0.1;
+    opt.banned_call_density = 0.002;
+    opt.scanf_density = 0.001;
+    return opt;
+}
+
+bool GenerateCorpus(const std::filesystem::path& out_dir, const CorpusOptions& opt, CorpusManifest& manifest, std::string& err)
+{
+    err.clear();
+    manifest.sites.clear();
+    manifest.files = 0;
+    manifest.bytes = 0;
+
+    CorpusRng rng(opt.seed);
+    std::error_code ec;
+
+    for (uint32_t n = 0; n < opt.file_count; n++)
+    {
+        const auto dir = out_dir / PickDirectory(rng, opt);
+        std::filesystem::create_directories(dir, ec);
+        if (ec)
+        {
+            err = "failed to create " + dir.string();
+            return false;
+        }
+
+        const auto file_path = dir / ("f" + std::to_string(n) + ((n % 3 == 0) ? ".h" : ".c"));
+        const size_t target = PickFileSize(rng, opt);
+
+        std::string text;
+        text.reserve(target + 256);
+
+        size_t line = 1;
+        const auto emit = [&](const std::string& s)
+        {
+            text += s;
+            text += '\n';
+            line++;
+        };
+
+        emit("#include <stdio.h>");
+        emit("");
+
+        uint32_t fn = 0;
+        while (text.size() < target)
+        {
+            emit("int fn" + std::to_string(fn) + "(char* buf, const char* src, const char* cmd, int n)");
+            emit("{");
+
+            const uint64_t body = 4 + rng.Below(24);
+            for (uint64_t b = 0; b < body; b++)
+            {
+                if (rng.Chance(opt.banned_call_density))
+                {
+                    const auto& call = kBannedCalls[rng.Below(sizeof(kBannedCalls) / sizeof(kBannedCalls[0]))];
+                    manifest.sites.push_back({ file_path, line, "CG0001" });
+                    emit(std::string("    ") + call);
+                }
+                else if (rng.Chance(opt.scanf_density))
+                {
+                    manifest.sites.push_back({ file_path, line, "CG0002" });
+                    emit("    scanf(\"%s\", buf);");
+                }
+                else if (rng.Chance(opt.comment_density))
+                {
+                    emit(std::string("    ") + kDecoyComments[rng.Below(sizeof(kDecoyComments) / sizeof(kDecoyComments[0]))]);
+                }
+                else if (rng.Chance(opt.string_density))
+                {
+                    emit(std::string("    ") + kDecoyStrings[rng.Below(sizeof(kDecoyStrings) / sizeof(kDecoyStrings[0]))]);
+                }
+                else if (rng.Chance(0.05))
+                {
+                    emit("    scanf(\"%15s\", buf);");
+                }
+                else
+                {
+                    emit("    n = n * " + std::to_string(rng.Below(100)) + " + strlen(src);");
+                }
+            }
+
+            emit("    return n;");
+            emit("}");
+            emit("");
+            fn++;
+        }
+
+        std::ofstream f(file_path, std::ios::binary | std::ios::trunc);
+        f.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!f)
+        {
+            err = "failed to write " + file_path.string();
+            return false;
+        }
+
+        manifest.files++;
+        manifest.bytes += text.size();
+    }
+
+    return true;
+}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace codeguard
+{
+struct CorpusOptions
+{
+    uint64_t seed;
+    uint32_t file_count;
+    uint32_t max_depth;
+    uint32_t dirs_per_level;
+    size_t mean_file_bytes;
+    size_t max_file_bytes;
+    double comment_density;
+    double string_density;
+    double banned_call_density;
+    double scanf_density;
+};
+
+struct PlantedSite
+{
+    std::filesystem::path file_path;
+    size_t line;
+    std::string rule_id;
+};
+
+struct CorpusManifest
+{
+    std::vector<PlantedSite> sites;
+    uint64_t files;
+    uint64_t bytes;
+};
+
+CorpusOptions DefaultCorpusOptions();
+
+// Deterministic for a given seed on every platform; densities are per generated line.
+bool GenerateCorpus(const std::filesystem::path& out_dir, const CorpusOptions& opt, CorpusManifest& manifest, std::string& err);
+}
@@ -0,0 +1,366 @@
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <set>
+#include <tuple>
+#include <thread>
+#include <cstdio>
+
+#include "../CodeGuardCLI/Scanner.h"
+#include "../CodeGuardCLI/Util.h"
+#include "../CodeGuardCLI/RegexRules.h"
+#include "CorpusGenerator.h"
+
+struct BenchOptions
+{
+    std::filesystem::path work_dir;
+    std::vector<uint32_t> file_counts;
+    std::vector<uint32_t> thread_counts;
+    codeguard::CorpusOptions corpus;
+    uint32_t repeats;
+    uint32_t regex_rules;
+};
+
+static void PrintUsage()
+{
+    std::cout << "Usage: CodeGuardBench <work_dir> [options]" << std::endl;
+    std::cout << "  --files <n,n,...>    corpus sizes in files (default: 1000,10000)" << std::endl;
+    std::cout << "  --threads <n,n,...>  thread counts (default: 1,2,4,...,cores)" << std::endl;
+    std::cout << "  --seed <n>           corpus seed (default: 1)" << std::endl;
+    std::cout << "  --mean-bytes <n>     mean file size (default: 8192)" << std::endl;
+    std::cout << "  --depth <n>          max directory depth (default: 4)" << std::endl;
+    std::cout << "  --comments <p>       comment line density (default: 0.2)" << std::endl;
+    std::cout << "  --strings <p>        string literal line density (default: 0.1)" << std::endl;
+    std::cout << "  --repeats <n>        timed runs per configuration, best is reported (default: 3)" << std::endl;
+    std::cout << "  --regex <n>          also time each configuration with n synthetic regex rules (default: 0)" << std::endl;
+}
+
+static bool ParseList(const std::string& s, std::vector<uint32_t>& out)
+{
+    out.clear();
+    size_t i = 0;
+    while (i < s.size())
+    {
+        size_t j = s.find(',', i);
+        if (j == std::string::npos)
+        {
+            j = s.size();
+        }
+        try
+        {
+            out.push_back(static_cast<uint32_t>(std::stoul(s.substr(i, j - i))));
+        }
+        catch (...)
+        {
+            return false;
+        }
+        i = j + 1;
+    }
+    return !out.empty();
+}
+
+static bool ParseArgs(int argc, char** argv, BenchOptions& opt)
+{
+    opt.corpus = codeguard::DefaultCorpusOptions();
+    opt.file_counts = { 1000, 10000 };
+    opt.thread_counts.clear();
+    opt.repeats = 3;
+    opt.regex_rules = 0;
+
+    const uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t t = 1; t < cores; t *= 2)
+    {
+        opt.thread_counts.push_back(t);
+    }
+    opt.thread_counts.push_back(cores);
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = (i + 1 < argc);
+
+            if (arg == "--files" && hasValue)
+            {
+                if (!ParseList(argv[++i], opt.file_counts))
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--threads" && hasValue)
+            {
+                if (!ParseList(argv[++i], opt.thread_counts))
+                {
+                    return false;
+                }
+            }
+            else if (arg == "--seed" && hasValue)
+            {
+                opt.corpus.seed = std::stoull(argv[++i]);
+            }
+            else if (arg == "--mean-bytes" && hasValue)
+            {
+                opt.corpus.mean_file_bytes = static_cast<size_t>(std::stoull(argv[++i]));
+                opt.corpus.max_file_bytes = std::max(opt.corpus.max_file_bytes, opt.corpus.mean_file_bytes);
+            }
+            else if (arg == "--depth" && hasValue)
+            {
+                opt.corpus.max_depth = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--comments" && hasValue)
+            {
+                opt.corpus.comment_density = std::stod(argv[++i]);
+            }
+            else if (arg == "--strings" && hasValue)
+            {
+                opt.corpus.string_density = std::stod(argv[++i]);
+            }
+            else if (arg == "--repeats" && hasValue)
+            {
+                opt.repeats = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+            }
+            else if (arg == "--regex" && hasValue)
+            {
+                opt.regex_rules = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
+            else if (!arg.empty() && arg[0] != '-' && opt.work_dir.empty())
+            {
+                opt.work_dir = std::filesystem::path(arg);
+            }
+            else
+            {
+                return false;
+            }
+        }
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return !opt.work_dir.empty();
+}
+
+static uint64_t PeakWorkingSetBytes()
+{
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    {
+        return static_cast<uint64_t>(pmc.PeakWorkingSetSize);
+    }
+    return 0;
+}
+
+using SiteKey = std::tuple<std::string, size_t, std::string>;
+
+// Returns the number of planted sites that were missed plus the number of unexpected findings.
+static size_t CheckOracle(const codeguard::CorpusManifest& manifest, const codeguard::ScanResult& result)
+{
+    std::set<SiteKey> expected;
+    for (const auto& s : manifest.sites)
+    {
+        expected.emplace(codeguard::PathToUtf8(s.file_path.lexically_normal()), s.line, s.rule_id);
+    }
+
+    std::set<SiteKey> actual;
+    for (const auto& f : result.findings)
+    {
+        actual.emplace(codeguard::PathToUtf8(f.file_path.lexically_normal()), f.line, f.rule_id);
+    }
+
+    size_t mismatches = 0;
+    for (const auto& k : expected)
+    {
+        mismatches += (actual.count(k) == 0) ? 1 : 0;
+    }
+    for (const auto& k : actual)
+    {
+        mismatches += (expected.count(k) == 0) ? 1 : 0;
+    }
+    return mismatches;
+}
+
+// Rules shaped like real ones (call patterns, argument shapes, secrets in literals) but keyed on
+// names the corpus generator never emits, so the oracle still expects exactly the planted sites.
+// Only a few use an unbounded gap: every such rule can be live at once and multiplies the DFA states.
+static std::vector<codeguard::RegexRule> SyntheticRegexRules(uint32_t n)
+{
+    std::vector<codeguard::RegexRule> rules;
+    char id[16];
+    for (uint32_t k = 0; k < n; k++)
+    {
+        const std::string name = "cgbench_rx" + std::to_string(k);
+        std::snprintf(id, sizeof(id), "RX%04u", k);
+
+        codeguard::RegexRule r;
+        r.rule_id = id;
+        r.severity = codeguard::Severity::Medium;
+        r.target = codeguard::RegexTarget::Code;
+        switch (k % 4)
+        {
+        case 0:
+            r.pattern = (k % 16 == 0)
+                ? name + "_copy\\s*\\(.*sizeof\\s*\\(\\s*\\w+\\s*\\*"
+                : name + "_alloc\\s*\\(\\s*\\w+\\s*\\*\\s*\\d+\\s*\\)";
+            break;
+        case 1:
+            r.target = codeguard::RegexTarget::Text;
+            r.pattern = "(?i)" + name + "_(token|secret)\\s*[:=]\\s*[A-Za-z0-9+/]{8,}";
+            break;
+        case 2:
+            r.pattern = "(" + name + "_lock|" + name + "_unlock)\\s*\\(\\s*&?\\w+(->|\\.)\\w+\\s*\\)";
+            break;
+        default:
+            r.pattern = name + "_fmt\\s*\\(\\s*[a-z_]+\\s*,\\s*\\w+\\s*\\)";
+            break;
+        }
+        rules.push_back(r);
+    }
+    return rules;
+}
+
+// Times opt.repeats runs after an untimed warm-up run, whose findings are checked against the oracle.
+static double TimeScanner(
+    codeguard::Scanner& scanner,
+    uint32_t repeats,
+    const codeguard::CorpusManifest& manifest,
+    size_t& mismatches
+)
+{
+    double best = 0.0;
+    for (uint32_t r = 0; r <= repeats; r++)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        const auto result = scanner.Run();
+        const auto t1 = std::chrono::steady_clock::now();
+
+        // Run 0 warms the file cache and is not timed.
+        if (r == 0)
+        {
+            mismatches += CheckOracle(manifest, result);
+            continue;
+        }
+
+        const double sec = std::chrono::duration<double>(t1 - t0).count();
+        if (best == 0.0 || sec < best)
+        {
+            best = sec;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions opt;
+    if (!ParseArgs(argc, argv, opt))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    codeguard::RegexRuleSet regex;
+    if (opt.regex_rules > 0)
+    {
+        std::string err;
+        if (!regex.Compile(SyntheticRegexRules(opt.regex_rules), err))
+        {
+            std::cout << "Regex error: " << err << std::endl;
+            return 2;
+        }
+        std::cout << "Regex rules: " << regex.Size()
+            << " (code: " << regex.DfaCount(codeguard::RegexTarget::Code) << " DFA, " << regex.DfaStates(codeguard::RegexTarget::Code) << " states;"
+            << " text: " << regex.DfaCount(codeguard::RegexTarget::Text) << " DFA, " << regex.DfaStates(codeguard::RegexTarget::Text) << " states)" << std::endl;
+    }
+
+    bool oracle_ok = true;
+
+    std::cout
+        << std::left << std::setw(8) << "files"
+        << std::setw(10) << "MB"
+        << std::setw(9) << "threads"
+        << std::setw(11) << "sec"
+        << std::setw(12) << "files/s"
+        << std::setw(10) << "MB/s"
+        << std::setw(12) << "peak MB"
+        << std::setw(11) << "scaling";
+    if (opt.regex_rules > 0)
+    {
+        std::cout << std::setw(12) << "regex MB/s" << std::setw(10) << "vs lit";
+    }
+    std::cout << "oracle" << std::endl;
+
+    for (const uint32_t files : opt.file_counts)
+    {
+        codeguard::CorpusOptions copt = opt.corpus;
+        copt.file_count = files;
+
+        const auto corpus_dir = opt.work_dir / ("corpus_" + std::to_string(files) + "_s" + std::to_string(copt.seed));
+        std::error_code ec;
+        std::filesystem::remove_all(corpus_dir, ec);
+
+        codeguard::CorpusManifest manifest;
+        std::string err;
+        if (!codeguard::GenerateCorpus(corpus_dir, copt, manifest, err))
+        {
+            std::cout << "Corpus error: " << err << std::endl;
+            return 2;
+        }
+
+        const double mb = static_cast<double>(manifest.bytes) / (1024.0 * 1024.0);
+        double single_thread_sec = 0.0;
+
+        for (const uint32_t threads : opt.thread_counts)
+        {
+            codeguard::Scanner scanner;
+            scanner.SetRoot(corpus_dir);
+            scanner.SetRunOptions({ threads, 0, false, codeguard::Severity::High });
+
+            size_t mismatches = 0;
+            const double best = TimeScanner(scanner, opt.repeats, manifest, mismatches);
+
+            double regex_best = 0.0;
+            if (opt.regex_rules > 0)
+            {
+                scanner.SetRegexRules(&regex);
+                regex_best = TimeScanner(scanner, opt.repeats, manifest, mismatches);
+            }
+
+            if (threads == opt.thread_counts.front())
+            {
+                single_thread_sec = best * static_cast<double>(threads);
+            }
+            const double scaling = (best > 0.0) ? single_thread_sec / (best * static_cast<double>(threads)) : 0.0;
+            oracle_ok = oracle_ok && (mismatches == 0);
+
+            std::cout
+                << std::left << std::setw(8) << files
+                << std::setw(10) << std::fixed << std::setprecision(1) << mb
+                << std::setw(9) << threads
+                << std::setw(11) << std::setprecision(4) << best
+                << std::setw(12) << std::setprecision(0) << (best > 0.0 ? static_cast<double>(manifest.files) / best : 0.0)
+                << std::setw(10) << std::setprecision(1) << (best > 0.0 ? mb / best : 0.0)
+                << std::setw(12) << std::setprecision(1) << static_cast<double>(PeakWorkingSetBytes()) / (1024.0 * 1024.0)
+                << std::setw(11) << std::setprecision(2) << scaling;
+            if (opt.regex_rules > 0)
+            {
+                std::cout
+                    << std::setw(12) << std::setprecision(1) << (regex_best > 0.0 ? mb / regex_best : 0.0)
+                    << std::setw(10) << std::setprecision(2) << (regex_best > 0.0 ? best / regex_best : 0.0);
+            }
+            std::cout
+                << ((mismatches == 0) ? std::string("ok") : ("FAIL (" + std::to_string(mismatches) + ")"))
+                << std::endl;
+        }
+    }
+
+    return oracle_ok ? 0 : 1;
+}
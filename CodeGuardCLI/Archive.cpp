@@ -0,0 +1,371 @@
+#include "Archive.h"
+
+#include "Inflate.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cwctype>
+
+namespace codeguard
+{
+static const size_t kTarBlock = 512;
+static const uint64_t kMaxMetaBytes = 1024 * 1024;
+
+static std::wstring LowerExtension(const std::filesystem::path& p)
+{
+    std::wstring e = p.extension().wstring();
+    for (auto& c : e)
+    {
+        c = static_cast<wchar_t>(towlower(c));
+    }
+    return e;
+}
+
+static bool IsGzipPath(const std::filesystem::path& p)
+{
+    const auto e = LowerExtension(p);
+    return e == L".tgz" || (e == L".gz" && LowerExtension(p.stem()) == L".tar");
+}
+
+bool IsArchivePath(const std::filesystem::path& p)
+{
+    return LowerExtension(p) == L".tar" || IsGzipPath(p);
+}
+
+static uint64_t ParseTarNumber(const char* field, size_t len)
+{
+    const auto* u = reinterpret_cast<const unsigned char*>(field);
+    if (len > 0 && (u[0] & 0x80))
+    {
+        uint64_t v = u[0] & 0x7f;
+        for (size_t i = 1; i < len; i++)
+        {
+            v = (v << 8) | u[i];
+        }
+        return v;
+    }
+
+    uint64_t v = 0;
+    size_t i = 0;
+    while (i < len && (field[i] == ' ' || field[i] == '\0'))
+    {
+        i++;
+    }
+    for (; i < len && field[i] >= '0' && field[i] <= '7'; i++)
+    {
+        v = (v << 3) | static_cast<uint64_t>(field[i] - '0');
+    }
+    return v;
+}
+
+static std::string FieldString(const char* field, size_t len)
+{
+    const size_t n = std::find(field, field + len, '\0') - field;
+    return std::string(field, n);
+}
+
+static std::string CleanMemberPath(std::string s)
+{
+    while (s.compare(0, 2, "./") == 0)
+    {
+        s.erase(0, 2);
+    }
+    while (!s.empty() && s[0] == '/')
+    {
+        s.erase(0, 1);
+    }
+    return s;
+}
+
+static std::string PaxPath(const std::string& records)
+{
+    size_t i = 0;
+    std::string path;
+    while (i < records.size())
+    {
+        const size_t space = records.find(' ', i);
+        if (space == std::string::npos)
+        {
+            break;
+        }
+        size_t len = 0;
+        for (size_t k = i; k < space; k++)
+        {
+            len = len * 10 + static_cast<size_t>(records[k] - '0');
+        }
+        if (len == 0 || i + len > records.size())
+        {
+            break;
+        }
+        const std::string rec = records.substr(space + 1, i + len - space - 2);
+        if (rec.compare(0, 5, "path=") == 0)
+        {
+            path = rec.substr(5);
+        }
+        i += len;
+    }
+    return path;
+}
+
+// Push parser: bytes arrive in arbitrary chunks from either the file or the gzip decoder.
+class TarStreamParser final
+{
+public:
+    TarStreamParser(const ArchiveEntryFilter& filter, const ArchiveEntryHandler& handler)
+        : want(filter), on_entry(handler)
+    {
+        state = State::Header;
+        header.reserve(kTarBlock);
+        remaining = 0;
+        padding = 0;
+        kind = Kind::Skip;
+        corrupt = false;
+    }
+
+    bool Feed(const char* data, size_t n);
+    bool Corrupt() const
+    {
+        return corrupt;
+    }
+    // The input ended inside a header or a member; a missing end-of-archive block alone is tolerated.
+    bool Truncated() const
+    {
+        return state == State::Data || state == State::Padding || (state == State::Header && !header.empty());
+    }
+
+private:
+    enum class State
+    {
+        Header,
+        Data,
+        Padding,
+        End
+    };
+
+    enum class Kind
+    {
+        Skip,
+        Member,
+        LongName,
+        Pax
+    };
+
+    const ArchiveEntryFilter& want;
+    const ArchiveEntryHandler& on_entry;
+
+    State state;
+    std::string header;
+    uint64_t remaining;
+    uint64_t padding;
+    Kind kind;
+    ArchiveEntry entry;
+    std::string content;
+    std::string long_name;
+    std::string pax_path;
+    bool corrupt;
+
+    void OnHeader();
+    void OnDataComplete();
+};
+
+void TarStreamParser::OnHeader()
+{
+    const char* h = header.data();
+
+    if (std::all_of(header.begin(), header.end(), [](char c) { return c == '\0'; }))
+    {
+        state = State::End;
+        return;
+    }
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < kTarBlock; i++)
+    {
+        sum += (i >= 148 && i < 156) ? static_cast<uint64_t>(' ') : static_cast<unsigned char>(h[i]);
+    }
+    if (sum != ParseTarNumber(h + 148, 8))
+    {
+        corrupt = true;
+        state = State::End;
+        return;
+    }
+
+    const char type = h[156];
+    const uint64_t size = ParseTarNumber(h + 124, 12);
+
+    std::string name = FieldString(h, 100);
+    if (std::string(h + 257, 5) == "ustar")
+    {
+        const std::string prefix = FieldString(h + 345, 155);
+        if (!prefix.empty())
+        {
+            name = prefix + "/" + name;
+        }
+    }
+    if (!pax_path.empty())
+    {
+        name = pax_path;
+    }
+    else if (!long_name.empty())
+    {
+        name = long_name;
+    }
+
+    kind = Kind::Skip;
+    content.clear();
+
+    if (type == 'L')
+    {
+        kind = (size <= kMaxMetaBytes) ? Kind::LongName : Kind::Skip;
+    }
+    else if (type == 'x')
+    {
+        kind = (size <= kMaxMetaBytes) ? Kind::Pax : Kind::Skip;
+    }
+    else
+    {
+        if (type == '0' || type == '\0' || type == '7')
+        {
+            entry.path = CleanMemberPath(name);
+            entry.size = size;
+            if (want(entry))
+            {
+                kind = Kind::Member;
+                content.reserve(static_cast<size_t>(size));
+            }
+        }
+        if (type != 'g')
+        {
+            long_name.clear();
+            pax_path.clear();
+        }
+    }
+
+    remaining = size;
+    padding = (kTarBlock - (size % kTarBlock)) % kTarBlock;
+    state = State::Data;
+    if (remaining == 0)
+    {
+        OnDataComplete();
+    }
+}
+
+void TarStreamParser::OnDataComplete()
+{
+    if (kind == Kind::Member)
+    {
+        on_entry(entry, content);
+    }
+    else if (kind == Kind::LongName)
+    {
+        long_name = FieldString(content.data(), content.size());
+    }
+    else if (kind == Kind::Pax)
+    {
+        pax_path = PaxPath(content);
+    }
+    content.clear();
+    state = (padding > 0) ? State::Padding : State::Header;
+}
+
+bool TarStreamParser::Feed(const char* data, size_t n)
+{
+    size_t i = 0;
+    while (i < n && state != State::End)
+    {
+        if (state == State::Header)
+        {
+            const size_t take = std::min(n - i, kTarBlock - header.size());
+            header.append(data + i, take);
+            i += take;
+            if (header.size() == kTarBlock)
+            {
+                OnHeader();
+                header.clear();
+            }
+        }
+        else if (state == State::Data)
+        {
+            const size_t take = static_cast<size_t>(std::min<uint64_t>(n - i, remaining));
+            if (kind != Kind::Skip)
+            {
+                content.append(data + i, take);
+            }
+            i += take;
+            remaining -= take;
+            if (remaining == 0)
+            {
+                OnDataComplete();
+            }
+        }
+        else if (state == State::Padding)
+        {
+            const size_t take = static_cast<size_t>(std::min<uint64_t>(n - i, padding));
+            i += take;
+            padding -= take;
+            if (padding == 0)
+            {
+                state = State::Header;
+            }
+        }
+    }
+    return state != State::End;
+}
+
+bool ReadTarArchive(
+    const std::filesystem::path& p,
+    const ArchiveEntryFilter& want,
+    const ArchiveEntryHandler& on_entry,
+    std::string& err
+)
+{
+    err.clear();
+
+    std::ifstream f(p, std::ios::binary);
+    if (!f)
+    {
+        err = "failed to open archive";
+        return false;
+    }
+
+    TarStreamParser parser(want, on_entry);
+    const InflateSink sink = [&](const char* data, size_t size)
+    {
+        return parser.Feed(data, size);
+    };
+
+    if (IsGzipPath(p))
+    {
+        if (!GunzipStream(f, sink, err))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        std::vector<char> buf(256 * 1024);
+        while (f)
+        {
+            f.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+            const size_t got = static_cast<size_t>(f.gcount());
+            if (got == 0 || !sink(buf.data(), got))
+            {
+                break;
+            }
+        }
+    }
+
+    if (parser.Corrupt())
+    {
+        err = "corrupt tar header";
+        return false;
+    }
+    if (parser.Truncated())
+    {
+        err = "truncated tar stream";
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <functional>
+#include <filesystem>
+
+namespace codeguard
+{
+struct ArchiveEntry
+{
+    std::string path;
+    uint64_t size;
+};
+
+// Decides per regular member whether its content should be buffered and handed to the handler.
+using ArchiveEntryFilter = std::function<bool(const ArchiveEntry&)>;
+using ArchiveEntryHandler = std::function<void(const ArchiveEntry&, std::string& content)>;
+
+bool IsArchivePath(const std::filesystem::path& p);
+
+// Streams a .tar, .tar.gz or .tgz file entry by entry without extracting it.
+bool ReadTarArchive(
+    const std::filesystem::path& p,
+    const ArchiveEntryFilter& want,
+    const ArchiveEntryHandler& on_entry,
+    std::string& err
+);
+}
@@ -0,0 +1,288 @@
+#include "Baseline.h"
+
+#include "Util.h"
+
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+
+namespace codeguard
+{
+static const char kBaselineMagic[4] = { 'C', 'G', 'B', 'L' };
+static const uint32_t kBaselineVersion = 1;
+// Keeps the slot table (2x entries, 8 bytes each) within a few GB.
+static const uint64_t kMaxBaselineEntries = 1ull << 28;
+
+// 0 marks an empty slot, so a real fingerprint of 0 is remapped.
+static uint64_t SlotKey(uint64_t fingerprint)
+{
+    return (fingerprint == 0) ? 1 : fingerprint;
+}
+
+static std::string NormalizeLineText(const std::string& line)
+{
+    std::string out;
+    out.reserve(line.size());
+
+    bool pendingSpace = false;
+    for (const char c : line)
+    {
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+        {
+            pendingSpace = !out.empty();
+            continue;
+        }
+        if (pendingSpace)
+        {
+            out.push_back(' ');
+            pendingSpace = false;
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+uint64_t FindingFingerprint(const Finding& f, const std::filesystem::path& root)
+{
+    uint64_t h = HashBytes(f.rule_id, 0);
+    h = HashBytes(NormalizeRelativePath(f.file_path, root), h);
+    h = HashBytes(NormalizeLineText(f.line_text), h);
+    return h;
+}
+
+Baseline::Baseline()
+{
+    used = 0;
+    total = 0;
+    Rehash(16);
+}
+
+bool Baseline::Load(const std::filesystem::path& p, std::string& err)
+{
+    err.clear();
+
+    std::ifstream f(p, std::ios::binary);
+    if (!f)
+    {
+        err = "failed to open baseline";
+        return false;
+    }
+
+    unsigned char header[16];
+    f.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!f || !std::equal(kBaselineMagic, kBaselineMagic + 4, reinterpret_cast<const char*>(header)))
+    {
+        err = "not a baseline file";
+        return false;
+    }
+
+    if (LoadLE(header + 4, 4) != kBaselineVersion)
+    {
+        err = "unsupported baseline version";
+        return false;
+    }
+
+    // The header count is untrusted; it must describe exactly the fingerprints that follow.
+    const uint64_t n = LoadLE(header + 8, 8);
+    std::error_code ec;
+    const uintmax_t size = std::filesystem::file_size(p, ec);
+    if (ec || (size - 16) % 8 != 0 || (size - 16) / 8 != n || n > kMaxBaselineEntries)
+    {
+        err = "corrupt baseline";
+        return false;
+    }
+
+    size_t capacity = 16;
+    while (capacity < n * 2)
+    {
+        capacity *= 2;
+    }
+    used = 0;
+    total = 0;
+    Rehash(capacity);
+
+    std::vector<unsigned char> buf(8 * 4096);
+    uint64_t remaining = n;
+    while (remaining > 0)
+    {
+        const size_t batch = static_cast<size_t>(std::min<uint64_t>(remaining, 4096));
+        f.read(reinterpret_cast<char*>(buf.data()), static_cast<std::streamsize>(batch * 8));
+        if (!f)
+        {
+            err = "truncated baseline";
+            return false;
+        }
+        for (size_t i = 0; i < batch; i++)
+        {
+            Insert(LoadLE(buf.data() + i * 8, 8));
+        }
+        remaining -= batch;
+    }
+
+    return true;
+}
+
+bool Baseline::Write(const std::filesystem::path& p, std::vector<uint64_t> fingerprints, std::string& err)
+{
+    err.clear();
+
+    // Duplicates are kept: each one is a separate accepted finding.
+    std::sort(fingerprints.begin(), fingerprints.end());
+
+    std::string out;
+    out.reserve(16 + fingerprints.size() * 8);
+    out.append(kBaselineMagic, 4);
+    AppendU32(out, kBaselineVersion);
+    AppendU64(out, static_cast<uint64_t>(fingerprints.size()));
+    for (const auto fp : fingerprints)
+    {
+        AppendU64(out, fp);
+    }
+
+    std::ofstream f(p, std::ios::binary | std::ios::trunc);
+    if (!f)
+    {
+        err = "failed to create baseline";
+        return false;
+    }
+    f.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!f)
+    {
+        err = "failed to write baseline";
+        return false;
+    }
+    return true;
+}
+
+void Baseline::Insert(uint64_t fingerprint)
+{
+    if ((used + 1) * 2 > slots.size())
+    {
+        Rehash(slots.size() * 2);
+    }
+
+    const uint64_t key = SlotKey(fingerprint);
+    const size_t mask = slots.size() - 1;
+    size_t i = static_cast<size_t>(key) & mask;
+    while (slots[i] != 0 && slots[i] != key)
+    {
+        i = (i + 1) & mask;
+    }
+    if (slots[i] == 0)
+    {
+        slots[i] = key;
+        used++;
+    }
+    counts[i]++;
+    total++;
+}
+
+uint32_t Baseline::Count(uint64_t fingerprint) const
+{
+    const uint64_t key = SlotKey(fingerprint);
+    const size_t mask = slots.size() - 1;
+    size_t i = static_cast<size_t>(key) & mask;
+    while (slots[i] != 0)
+    {
+        if (slots[i] == key)
+        {
+            return counts[i];
+        }
+        i = (i + 1) & mask;
+    }
+    return 0;
+}
+
+size_t Baseline::Size() const
+{
+    return total;
+}
+
+uint64_t Baseline::ContentHash() const
+{
+    std::vector<std::pair<uint64_t, uint32_t>> keys;
+    keys.reserve(used);
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        if (slots[i] != 0)
+        {
+            keys.emplace_back(slots[i], counts[i]);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::string bytes;
+    bytes.reserve(keys.size() * 12);
+    for (const auto& key : keys)
+    {
+        AppendU64(bytes, key.first);
+        AppendU32(bytes, key.second);
+    }
+    return HashBytes(bytes, 0);
+}
+
+void Baseline::Rehash(size_t capacity)
+{
+    std::vector<uint64_t> old;
+    std::vector<uint32_t> old_counts;
+    old.swap(slots);
+    old_counts.swap(counts);
+    slots.assign(capacity, 0);
+    counts.assign(capacity, 0);
+
+    const size_t mask = capacity - 1;
+    for (size_t k = 0; k < old.size(); k++)
+    {
+        if (old[k] == 0)
+        {
+            continue;
+        }
+        size_t i = static_cast<size_t>(old[k]) & mask;
+        while (slots[i] != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        slots[i] = old[k];
+        counts[i] = old_counts[k];
+    }
+}
+
+uint64_t ApplyBaseline(ScanResult& result, const Baseline& baseline, const std::filesystem::path& root)
+{
+    if (baseline.Size() == 0)
+    {
+        return 0;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> matched;
+    const auto before = result.findings.size();
+    result.findings.erase(
+        std::remove_if(
+            result.findings.begin(),
+            result.findings.end(),
+            [&](const Finding& f)
+            {
+                const uint64_t fp = FindingFingerprint(f, root);
+                const uint32_t allowed = baseline.Count(fp);
+                if (allowed == 0)
+                {
+                    return false;
+                }
+                uint32_t& seen = matched[fp];
+                if (seen >= allowed)
+                {
+                    return false;
+                }
+                seen++;
+                return true;
+            }
+        ),
+        result.findings.end()
+    );
+
+    const uint64_t suppressed = static_cast<uint64_t>(before - result.findings.size());
+    result.stats.findings -= suppressed;
+    result.stats.findings_baselined += suppressed;
+    return suppressed;
+}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Scanner.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+namespace codeguard
+{
+// Stable across line-number drift: rule id + root-relative path + normalized line text.
+uint64_t FindingFingerprint(const Finding& f, const std::filesystem::path& root);
+
+class Baseline final
+{
+public:
+    Baseline();
+
+    bool Load(const std::filesystem::path& p, std::string& err);
+    static bool Write(const std::filesystem::path& p, std::vector<uint64_t> fingerprints, std::string& err);
+
+    // A fingerprint may be inserted several times: identical lines in one file share it.
+    void Insert(uint64_t fingerprint);
+    uint32_t Count(uint64_t fingerprint) const;
+    size_t Size() const;
+    // Independent of insertion order; identifies the baseline a checkpoint was written against.
+    uint64_t ContentHash() const;
+
+private:
+    std::vector<uint64_t> slots;
+    std::vector<uint32_t> counts;
+    size_t used;
+    size_t total;
+
+    void Rehash(size_t capacity);
+};
+
+// Removes baselined findings from result and returns how many were suppressed. A fingerprint hides at
+// most as many findings as the baseline recorded for it, so a new copy of an accepted line is reported.
+// Fingerprints include the path, so result must hold every finding of the files it covers.
+uint64_t ApplyBaseline(ScanResult& result, const Baseline& baseline, const std::filesystem::path& root);
+}
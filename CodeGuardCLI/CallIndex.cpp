@@ -0,0 +1,590 @@
+#include "CallIndex.h"
+
+#include "Util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <unordered_set>
+
+namespace codeguard
+{
+static const char kCallIndexMagic[4] = { 'C', 'G', 'C', 'I' };
+static const uint32_t kCallIndexVersion = 2;
+static const size_t kShardCount = 32;
+
+CallIndex::CallIndex()
+    : shards(new Shard[kShardCount])
+{
+    files.clear();
+    reindexed = 0;
+}
+
+CallIndex::~CallIndex() = default;
+
+CallIndex::Shard& CallIndex::LocalShard()
+{
+    static std::atomic<size_t> next_shard(0);
+    thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+    return shards[shard];
+}
+
+static void AppendString(std::string& out, const std::string& s)
+{
+    AppendU32(out, static_cast<uint32_t>(s.size()));
+    out += s;
+}
+
+namespace
+{
+struct Reader
+{
+    const std::string& data;
+    size_t pos;
+
+    bool U32(uint32_t& v)
+    {
+        if (data.size() - pos < 4)
+        {
+            return false;
+        }
+        v = static_cast<uint32_t>(LoadLE(reinterpret_cast<const unsigned char*>(data.data() + pos), 4));
+        pos += 4;
+        return true;
+    }
+
+    bool U64(uint64_t& v)
+    {
+        if (data.size() - pos < 8)
+        {
+            return false;
+        }
+        v = LoadLE(reinterpret_cast<const unsigned char*>(data.data() + pos), 8);
+        pos += 8;
+        return true;
+    }
+
+    bool String(std::string& s)
+    {
+        uint32_t n = 0;
+        if (!U32(n) || data.size() - pos < n)
+        {
+            return false;
+        }
+        s.assign(data, pos, n);
+        pos += n;
+        return true;
+    }
+};
+}
+
+bool CallIndex::Load(const std::filesystem::path& p, std::string& err)
+{
+    err.clear();
+    files.clear();
+
+    // The index grows with the repository, so it is not subject to the source file size limit.
+    std::string data;
+    if (!ReadFileAll(p, data, err, UINT64_MAX))
+    {
+        err = "call index: " + err;
+        return false;
+    }
+
+    if (data.size() < 16 || !std::equal(kCallIndexMagic, kCallIndexMagic + 4, data.data()))
+    {
+        err = "not a call index file";
+        return false;
+    }
+
+    Reader r{ data, 4 };
+    uint32_t version = 0;
+    uint64_t count = 0;
+    r.U32(version);
+    r.U64(count);
+    // Older layouts lack fields that cannot be recovered, so the index is rebuilt from scratch.
+    if (version < kCallIndexVersion)
+    {
+        return true;
+    }
+    if (version != kCallIndexVersion)
+    {
+        err = "unsupported call index version";
+        return false;
+    }
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        IndexedFile f;
+        uint32_t fn_count = 0;
+        if (!r.U64(f.path_key) || !r.U64(f.content_hash) || !r.String(f.path) || !r.U32(fn_count))
+        {
+            err = "truncated call index";
+            return false;
+        }
+
+        f.functions.resize(std::min<size_t>(fn_count, (data.size() - r.pos) / 12));
+        if (f.functions.size() != fn_count)
+        {
+            err = "truncated call index";
+            return false;
+        }
+
+        for (auto& fn : f.functions)
+        {
+            uint32_t call_count = 0;
+            if (!r.String(fn.name) || !r.U32(fn.line) || !r.U32(call_count) || call_count > (data.size() - r.pos) / 17)
+            {
+                err = "truncated call index";
+                return false;
+            }
+
+            fn.calls.resize(call_count);
+            for (auto& c : fn.calls)
+            {
+                if (!r.String(c.callee) || !r.U32(c.line) || !r.U32(c.column) || !r.String(c.line_text) || r.pos >= data.size())
+                {
+                    err = "truncated call index";
+                    return false;
+                }
+                c.suppressed = (data[r.pos++] != 0);
+            }
+        }
+
+        const uint64_t key = f.path_key;
+        files[key] = std::move(f);
+    }
+
+    return true;
+}
+
+bool CallIndex::Save(const std::filesystem::path& p, std::string& err) const
+{
+    err.clear();
+
+    std::vector<const IndexedFile*> sorted;
+    sorted.reserve(files.size());
+    for (const auto& kv : files)
+    {
+        sorted.push_back(&kv.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const IndexedFile* a, const IndexedFile* b)
+    {
+        return a->path_key < b->path_key;
+    });
+
+    std::string out;
+    out.append(kCallIndexMagic, 4);
+    AppendU32(out, kCallIndexVersion);
+    AppendU64(out, static_cast<uint64_t>(sorted.size()));
+    for (const IndexedFile* f : sorted)
+    {
+        AppendU64(out, f->path_key);
+        AppendU64(out, f->content_hash);
+        AppendString(out, f->path);
+        AppendU32(out, static_cast<uint32_t>(f->functions.size()));
+        for (const auto& fn : f->functions)
+        {
+            AppendString(out, fn.name);
+            AppendU32(out, fn.line);
+            AppendU32(out, static_cast<uint32_t>(fn.calls.size()));
+            for (const auto& c : fn.calls)
+            {
+                AppendString(out, c.callee);
+                AppendU32(out, c.line);
+                AppendU32(out, c.column);
+                AppendString(out, c.line_text);
+                out.push_back(c.suppressed ? 1 : 0);
+            }
+        }
+    }
+
+    std::ofstream f(p, std::ios::binary | std::ios::trunc);
+    if (!f)
+    {
+        err = "failed to create call index";
+        return false;
+    }
+    f.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!f)
+    {
+        err = "failed to write call index";
+        return false;
+    }
+    return true;
+}
+
+void CallIndex::BeginUpdate()
+{
+    for (size_t i = 0; i < kShardCount; i++)
+    {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        shards[i].files.clear();
+        shards[i].reindexed = 0;
+    }
+    reindexed = 0;
+}
+
+bool CallIndex::Reuse(uint64_t path_key, uint64_t content_hash, const std::string& path)
+{
+    const auto it = files.find(path_key);
+    if (it == files.end() || it->second.content_hash != content_hash)
+    {
+        return false;
+    }
+
+    IndexedFile copy = it->second;
+    copy.path = path;
+
+    Shard& s = LocalShard();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.files.push_back(std::move(copy));
+    return true;
+}
+
+void CallIndex::Stage(IndexedFile&& file)
+{
+    Shard& s = LocalShard();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.files.push_back(std::move(file));
+    s.reindexed++;
+}
+
+void CallIndex::CommitUpdate(bool complete)
+{
+    if (complete)
+    {
+        files.clear();
+    }
+
+    for (size_t i = 0; i < kShardCount; i++)
+    {
+        Shard& s = shards[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (auto& f : s.files)
+        {
+            const uint64_t key = f.path_key;
+            files[key] = std::move(f);
+        }
+        reindexed += s.reindexed;
+        s.files.clear();
+        s.reindexed = 0;
+    }
+}
+
+size_t CallIndex::Size() const
+{
+    return files.size();
+}
+
+size_t CallIndex::Reindexed() const
+{
+    return reindexed;
+}
+
+void CallIndex::FindWrapperCalls(const std::vector<std::string>& banned, const WrapperCallCallback& on_call) const
+{
+    // Walk files in path order so the chosen chain is the same from run to run.
+    std::vector<const IndexedFile*> sorted;
+    sorted.reserve(files.size());
+    for (const auto& kv : files)
+    {
+        sorted.push_back(&kv.second);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const IndexedFile* a, const IndexedFile* b)
+    {
+        return a->path < b->path;
+    });
+
+    std::unordered_map<std::string, std::vector<std::string>> callers;
+    for (const IndexedFile* f : sorted)
+    {
+        for (const auto& fn : f->functions)
+        {
+            for (const auto& c : fn.calls)
+            {
+                callers[c.callee].push_back(fn.name);
+            }
+        }
+    }
+
+    // Breadth-first from the banned names over reversed edges; next_hop gives the shortest chain.
+    std::unordered_map<std::string, std::string> next_hop;
+    std::unordered_set<std::string> banned_set(banned.begin(), banned.end());
+    std::deque<std::string> queue(banned.begin(), banned.end());
+    while (!queue.empty())
+    {
+        const std::string name = std::move(queue.front());
+        queue.pop_front();
+
+        const auto it = callers.find(name);
+        if (it == callers.end())
+        {
+            continue;
+        }
+        for (const auto& caller : it->second)
+        {
+            if (banned_set.count(caller) == 0 && next_hop.emplace(caller, name).second)
+            {
+                queue.push_back(caller);
+            }
+        }
+    }
+
+    if (next_hop.empty())
+    {
+        return;
+    }
+
+    std::vector<std::string> chain;
+    for (const IndexedFile* f : sorted)
+    {
+        for (const auto& fn : f->functions)
+        {
+            for (const auto& c : fn.calls)
+            {
+                auto it = next_hop.find(c.callee);
+                if (it == next_hop.end())
+                {
+                    continue;
+                }
+
+                chain.clear();
+                chain.push_back(c.callee);
+                while (it != next_hop.end())
+                {
+                    chain.push_back(it->second);
+                    it = next_hop.find(it->second);
+                }
+                on_call(*f, c, chain);
+            }
+        }
+    }
+}
+
+static bool IsNotCallKeyword(std::string_view s)
+{
+    static const char* const kKeywords[] = {
+        "if", "for", "while", "switch", "return", "sizeof", "alignof", "alignas", "decltype",
+        "catch", "throw", "noexcept", "static_assert", "typeid", "new", "delete", "defined",
+        "co_await", "co_return", "co_yield", "__attribute__", "__declspec", "__pragma", "_Pragma",
+        "static_cast", "const_cast", "reinterpret_cast", "dynamic_cast"
+    };
+
+    for (const char* k : kKeywords)
+    {
+        if (s == k)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static size_t SkipParens(const std::string& s, size_t open)
+{
+    int depth = 0;
+    for (size_t i = open; i < s.size(); i++)
+    {
+        if (s[i] == '(')
+        {
+            depth++;
+        }
+        else if (s[i] == ')' && --depth == 0)
+        {
+            return i + 1;
+        }
+    }
+    return s.size();
+}
+
+// Brace-scope walk over sanitized text. Outside function bodies the last "name(...)" before a '{'
+// names the definition (a ':' locks it so constructor initializer lists do not replace it; '=' or ';'
+// clears it). Inside a body every "name(" that is not a keyword or member access is a call.
+void CallIndex::ExtractFunctions(
+    const std::string& raw,
+    const std::string& sanitized,
+    const LineIndex& idx,
+    const SuppressionTable& suppressions,
+    std::vector<IndexedFunction>& out
+)
+{
+    const std::string& s = sanitized;
+    const size_t n = s.size();
+
+    std::vector<bool> scopes;
+    bool in_function = false;
+    size_t pending_pos = std::string::npos;
+    size_t pending_len = 0;
+    bool pending_locked = false;
+    bool in_initializer = false;
+    bool at_line_start = true;
+
+    const auto reset_pending = [&]()
+    {
+        pending_pos = std::string::npos;
+        pending_locked = false;
+        in_initializer = false;
+    };
+
+    size_t i = 0;
+    while (i < n)
+    {
+        const char c = s[i];
+        if (c == '\n')
+        {
+            at_line_start = true;
+            i++;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v')
+        {
+            i++;
+            continue;
+        }
+
+        if (c == '#' && at_line_start)
+        {
+            while (i < n && s[i] != '\n')
+            {
+                if (s[i] == '\\' && i + 1 < n && (s[i + 1] == '\n' || s[i + 1] == '\r'))
+                {
+                    i += (s[i + 1] == '\r' && i + 2 < n && s[i + 2] == '\n') ? 3 : 2;
+                    continue;
+                }
+                i++;
+            }
+            continue;
+        }
+        at_line_start = false;
+
+        if (IsIdentChar(static_cast<unsigned char>(c)))
+        {
+            const size_t start = i;
+            while (i < n && IsIdentChar(static_cast<unsigned char>(s[i])))
+            {
+                i++;
+            }
+            if (c >= '0' && c <= '9')
+            {
+                continue;
+            }
+
+            size_t j = i;
+            while (j < n && (s[j] == ' ' || s[j] == '\t' || s[j] == '\r' || s[j] == '\n'))
+            {
+                j++;
+            }
+            if (j >= n || s[j] != '(')
+            {
+                continue;
+            }
+
+            const std::string_view name(s.data() + start, i - start);
+            if (IsNotCallKeyword(name))
+            {
+                continue;
+            }
+
+            if (in_function)
+            {
+                size_t k = start;
+                while (k > 0 && (s[k - 1] == ' ' || s[k - 1] == '\t'))
+                {
+                    k--;
+                }
+                const bool member = k > 0 && (s[k - 1] == '.' || (s[k - 1] == '>' && k > 1 && s[k - 2] == '-'));
+                if (!member && !out.empty())
+                {
+                    const size_t line = idx.LineFromIndex(start);
+                    CallSite site;
+                    site.callee = std::string(name);
+                    site.line = static_cast<uint32_t>(line);
+                    site.column = static_cast<uint32_t>(idx.ColFromIndex(start, line));
+                    site.suppressed = !suppressions.ranges.empty() && suppressions.IsSuppressed(line, "CG0004");
+                    site.line_text = std::string(idx.LineText(raw, line));
+                    out.back().calls.push_back(std::move(site));
+                }
+                continue;
+            }
+
+            if (!pending_locked && !in_initializer)
+            {
+                pending_pos = start;
+                pending_len = i - start;
+            }
+            i = SkipParens(s, j);
+            continue;
+        }
+
+        switch (c)
+        {
+            case '{':
+                if (!in_function && pending_pos != std::string::npos && !in_initializer)
+                {
+                    IndexedFunction fn;
+                    fn.name.assign(s, pending_pos, pending_len);
+                    fn.line = static_cast<uint32_t>(idx.LineFromIndex(pending_pos));
+                    out.push_back(std::move(fn));
+                    in_function = true;
+                    scopes.push_back(true);
+                }
+                else
+                {
+                    scopes.push_back(false);
+                }
+                if (!in_function)
+                {
+                    reset_pending();
+                }
+                break;
+
+            case '}':
+                if (!scopes.empty())
+                {
+                    if (scopes.back())
+                    {
+                        in_function = false;
+                    }
+                    scopes.pop_back();
+                }
+                if (!in_function)
+                {
+                    reset_pending();
+                }
+                break;
+
+            case ';':
+                if (!in_function)
+                {
+                    reset_pending();
+                }
+                break;
+
+            case '=':
+                if (!in_function)
+                {
+                    pending_pos = std::string::npos;
+                    in_initializer = true;
+                }
+                break;
+
+            case ':':
+                if (i + 1 < n && s[i + 1] == ':')
+                {
+                    i++;
+                }
+                else if (!in_function && pending_pos != std::string::npos)
+                {
+                    pending_locked = true;
+                }
+                break;
+
+            default:
+                break;
+        }
+        i++;
+    }
+}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <filesystem>
+
+namespace codeguard
+{
+struct LineIndex;
+struct SuppressionTable;
+
+struct CallSite
+{
+    std::string callee;
+    uint32_t line;
+    uint32_t column;
+    bool suppressed;
+    // Raw source line, kept so reports need not re-read the file (archive members cannot be re-read).
+    std::string line_text;
+};
+
+struct IndexedFunction
+{
+    std::string name;
+    uint32_t line;
+    std::vector<CallSite> calls;
+};
+
+struct IndexedFile
+{
+    uint64_t path_key;
+    uint64_t content_hash;
+    std::string path;
+    std::vector<IndexedFunction> functions;
+};
+
+// Callee names from the call site down to the banned function, e.g. { "safe_copy", "copy_impl", "strcpy" }.
+using WrapperCallCallback = std::function<void(const IndexedFile& file, const CallSite& site, const std::vector<std::string>& chain)>;
+
+// Repository-wide index of function definitions and the calls made from their bodies, keyed by path.
+// Files are staged from worker threads during Run() and merged afterwards; entries whose content hash
+// is unchanged are carried over without re-extracting.
+class CallIndex final
+{
+public:
+    CallIndex();
+    ~CallIndex();
+
+    CallIndex(const CallIndex&) = delete;
+    CallIndex& operator=(const CallIndex&) = delete;
+
+    bool Load(const std::filesystem::path& p, std::string& err);
+    bool Save(const std::filesystem::path& p, std::string& err) const;
+
+    void BeginUpdate();
+
+    // Thread-safe. Returns true and stages the stored entry when its content hash matches.
+    bool Reuse(uint64_t path_key, uint64_t content_hash, const std::string& path);
+    void Stage(IndexedFile&& file);
+
+    // complete=false keeps entries for files that were not reached, so an interrupted scan loses nothing.
+    void CommitUpdate(bool complete);
+
+    size_t Size() const;
+    size_t Reindexed() const;
+
+    // Name-based resolution: a function reaches a banned name if any definition with its name calls it,
+    // directly or through other indexed functions. Reports every call site of such a wrapper.
+    void FindWrapperCalls(const std::vector<std::string>& banned, const WrapperCallCallback& on_call) const;
+
+    static void ExtractFunctions(
+        const std::string& raw,
+        const std::string& sanitized,
+        const LineIndex& idx,
+        const SuppressionTable& suppressions,
+        std::vector<IndexedFunction>& out
+    );
+
+private:
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        std::vector<IndexedFile> files;
+        size_t reindexed = 0;
+    };
+
+    Shard& LocalShard();
+
+    std::unordered_map<uint64_t, IndexedFile> files;
+    std::unique_ptr<Shard[]> shards;
+    size_t reindexed;
+};
+}
@@ -0,0 +1,339 @@
+#include "Checkpoint.h"
+
+#include "Util.h"
+
+#include <algorithm>
+#include <system_error>
+
+namespace codeguard
+{
+static const char kCheckpointMagic[4] = { 'C', 'G', 'C', 'P' };
+static const uint32_t kCheckpointVersion = 3;
+static const size_t kFlushBytes = 256 * 1024;
+static const auto kFlushInterval = std::chrono::seconds(2);
+
+static void AppendString(std::string& out, const std::string& s)
+{
+    AppendU32(out, static_cast<uint32_t>(s.size()));
+    out += s;
+}
+
+static void EncodeStats(std::string& out, const ScanStats& st)
+{
+    const uint64_t fields[] = {
+        st.files_seen, st.files_scanned, st.bytes_scanned, st.findings, st.findings_baselined, st.findings_suppressed,
+        st.files_binary, st.files_utf16, st.files_generated, st.archives_scanned, st.files_prefiltered, st.archives_unreadable
+    };
+    for (const uint64_t v : fields)
+    {
+        AppendU64(out, v);
+    }
+}
+
+namespace
+{
+struct RecordReader
+{
+    const std::string& data;
+    size_t pos;
+    size_t end;
+
+    bool U32(uint32_t& v)
+    {
+        if (end - pos < 4)
+        {
+            return false;
+        }
+        v = static_cast<uint32_t>(LoadLE(reinterpret_cast<const unsigned char*>(data.data() + pos), 4));
+        pos += 4;
+        return true;
+    }
+
+    bool U64(uint64_t& v)
+    {
+        if (end - pos < 8)
+        {
+            return false;
+        }
+        v = LoadLE(reinterpret_cast<const unsigned char*>(data.data() + pos), 8);
+        pos += 8;
+        return true;
+    }
+
+    bool String(std::string& s)
+    {
+        uint32_t n = 0;
+        if (!U32(n) || end - pos < n)
+        {
+            return false;
+        }
+        s.assign(data, pos, n);
+        pos += n;
+        return true;
+    }
+};
+}
+
+static bool DecodeRecord(RecordReader& r, uint64_t& path_key, uint64_t& stamp, ScanResult& out)
+{
+    uint64_t fields[12];
+    if (!r.U64(path_key) || !r.U64(stamp))
+    {
+        return false;
+    }
+    for (auto& v : fields)
+    {
+        if (!r.U64(v))
+        {
+            return false;
+        }
+    }
+    out.stats = { fields[0], fields[1], fields[2], fields[3], fields[4], fields[5], fields[6], fields[7], fields[8], fields[9], fields[10], fields[11] };
+    out.stopped_early = false;
+
+    uint32_t count = 0;
+    if (!r.U32(count))
+    {
+        return false;
+    }
+
+    out.findings.clear();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Finding f;
+        std::string path;
+        uint32_t line = 0;
+        uint32_t column = 0;
+        uint32_t severity = 0;
+        if (!r.String(path) || !r.U32(line) || !r.U32(column) || !r.String(f.rule_id) || !r.U32(severity) || !r.String(f.message) || !r.String(f.line_text))
+        {
+            return false;
+        }
+        f.file_path = PathFromUtf8(path);
+        f.line = line;
+        f.column = column;
+        f.severity = static_cast<Severity>(std::min<uint32_t>(severity, static_cast<uint32_t>(Severity::High)));
+        out.findings.push_back(std::move(f));
+    }
+    return true;
+}
+
+ScanCheckpoint::ScanCheckpoint()
+{
+    completed.clear();
+    restored = 0;
+    last_flush = std::chrono::steady_clock::now();
+}
+
+ScanCheckpoint::~ScanCheckpoint()
+{
+    Close();
+}
+
+bool ScanCheckpoint::Load(const std::filesystem::path& p, uint64_t signature, std::string& err)
+{
+    // Checkpoints of long scans grow without bound, so records are streamed instead of reading the whole file.
+    std::error_code ec;
+    const uintmax_t size = std::filesystem::file_size(p, ec);
+    std::ifstream in(p, std::ios::binary);
+    if (ec || !in)
+    {
+        err = "failed to open checkpoint";
+        return false;
+    }
+
+    unsigned char header[16];
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || !std::equal(kCheckpointMagic, kCheckpointMagic + 4, reinterpret_cast<const char*>(header)))
+    {
+        err = "not a checkpoint file";
+        return false;
+    }
+    if (LoadLE(header + 4, 4) != kCheckpointVersion)
+    {
+        err = "unsupported checkpoint version";
+        return false;
+    }
+    if (LoadLE(header + 8, 8) != signature)
+    {
+        err = "checkpoint was written for a different root or options";
+        return false;
+    }
+
+    uint64_t pos = 16;
+    std::string payload;
+    unsigned char rec[12];
+    while (size - pos >= 12 && in.read(reinterpret_cast<char*>(rec), sizeof(rec)))
+    {
+        const uint64_t len = LoadLE(rec, 4);
+        const uint64_t checksum = LoadLE(rec + 4, 8);
+        if (len > size - pos - 12)
+        {
+            break;
+        }
+
+        payload.resize(static_cast<size_t>(len));
+        if (!in.read(payload.data(), static_cast<std::streamsize>(len)) || HashBytes(payload, 0) != checksum)
+        {
+            break;
+        }
+
+        RecordReader r{ payload, 0, payload.size() };
+        uint64_t key = 0;
+        Completed entry;
+        if (!DecodeRecord(r, key, entry.stamp, entry.result))
+        {
+            break;
+        }
+        completed[key] = std::move(entry);
+        pos += 12 + len;
+    }
+    in.close();
+
+    // Drop a torn tail so new records follow the last complete one.
+    if (pos != size)
+    {
+        std::filesystem::resize_file(p, pos, ec);
+        if (ec)
+        {
+            err = "failed to truncate checkpoint";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ScanCheckpoint::Open(const std::filesystem::path& p, uint64_t signature, bool resume, std::string& err)
+{
+    err.clear();
+    Close();
+    completed.clear();
+    restored = 0;
+
+    std::error_code ec;
+    const bool existing = resume && std::filesystem::exists(p, ec);
+    if (existing && !Load(p, signature, err))
+    {
+        return false;
+    }
+
+    out.open(p, std::ios::binary | (existing ? std::ios::app : std::ios::trunc));
+    if (!out)
+    {
+        err = "failed to create checkpoint";
+        return false;
+    }
+
+    if (!existing)
+    {
+        std::string header;
+        header.append(kCheckpointMagic, 4);
+        AppendU32(header, kCheckpointVersion);
+        AppendU64(header, signature);
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.flush();
+    }
+
+    last_flush = std::chrono::steady_clock::now();
+    return static_cast<bool>(out);
+}
+
+void ScanCheckpoint::Close()
+{
+    if (out.is_open())
+    {
+        Flush();
+        out.close();
+    }
+}
+
+bool ScanCheckpoint::Take(uint64_t path_key, uint64_t stamp, ScanResult& result)
+{
+    const auto it = completed.find(path_key);
+    if (it == completed.end())
+    {
+        return false;
+    }
+    const bool current = (stamp != 0 && it->second.stamp == stamp);
+    if (current)
+    {
+        result = std::move(it->second.result);
+        restored++;
+    }
+    completed.erase(it);
+    return current;
+}
+
+size_t ScanCheckpoint::Restored() const
+{
+    return restored;
+}
+
+void ScanCheckpoint::Append(uint64_t path_key, uint64_t stamp, const ScanResult& file_result)
+{
+    std::string payload;
+    AppendU64(payload, path_key);
+    AppendU64(payload, stamp);
+    EncodeStats(payload, file_result.stats);
+    AppendU32(payload, static_cast<uint32_t>(file_result.findings.size()));
+    for (const auto& f : file_result.findings)
+    {
+        AppendString(payload, PathToUtf8(f.file_path));
+        AppendU32(payload, static_cast<uint32_t>(f.line));
+        AppendU32(payload, static_cast<uint32_t>(f.column));
+        AppendString(payload, f.rule_id);
+        AppendU32(payload, static_cast<uint32_t>(f.severity));
+        AppendString(payload, f.message);
+        AppendString(payload, f.line_text);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    AppendU32(pending, static_cast<uint32_t>(payload.size()));
+    AppendU64(pending, HashBytes(payload, 0));
+    pending += payload;
+
+    if (pending.size() >= kFlushBytes || std::chrono::steady_clock::now() - last_flush >= kFlushInterval)
+    {
+        FlushLocked();
+    }
+}
+
+uint64_t ScanCheckpoint::FileStamp(const std::filesystem::path& p)
+{
+    std::error_code ec;
+    const uintmax_t size = std::filesystem::file_size(p, ec);
+    if (ec)
+    {
+        return 0;
+    }
+    const auto mtime = std::filesystem::last_write_time(p, ec);
+    if (ec)
+    {
+        return 0;
+    }
+
+    std::string bytes;
+    AppendU64(bytes, static_cast<uint64_t>(size));
+    AppendU64(bytes, static_cast<uint64_t>(mtime.time_since_epoch().count()));
+    const uint64_t h = HashBytes(bytes, 0);
+    return (h == 0) ? 1 : h;
+}
+
+void ScanCheckpoint::Flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    FlushLocked();
+}
+
+void ScanCheckpoint::FlushLocked()
+{
+    if (!pending.empty() && out.is_open())
+    {
+        out.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+        out.flush();
+        pending.clear();
+    }
+    last_flush = std::chrono::steady_clock::now();
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Scanner.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+
+namespace codeguard
+{
+// Append-only record of completed files and their findings, so an interrupted Run() can resume.
+// Each record also stores the file's size and mtime stamp; a file changed since is scanned again.
+// Each record carries its own length and checksum; a torn record at the tail (process killed
+// mid-write) is dropped on load and the file is truncated back to the last complete record.
+class ScanCheckpoint final
+{
+public:
+    ScanCheckpoint();
+    ~ScanCheckpoint();
+
+    ScanCheckpoint(const ScanCheckpoint&) = delete;
+    ScanCheckpoint& operator=(const ScanCheckpoint&) = delete;
+
+    // signature identifies root and options (Scanner::RunSignature); resume only accepts a matching file.
+    // Without resume, or when the file does not exist, a new checkpoint is started.
+    bool Open(const std::filesystem::path& p, uint64_t signature, bool resume, std::string& err);
+    void Close();
+
+    // Single-threaded, before workers start. Moves the stored result out if the stamp still matches.
+    bool Take(uint64_t path_key, uint64_t stamp, ScanResult& out);
+    size_t Restored() const;
+
+    // Thread-safe. Records are buffered and written at most once per interval or buffer size.
+    void Append(uint64_t path_key, uint64_t stamp, const ScanResult& file_result);
+    void Flush();
+
+    // Size and last write time of p, or 0 if it cannot be read; taken before the file is scanned.
+    static uint64_t FileStamp(const std::filesystem::path& p);
+
+private:
+    bool Load(const std::filesystem::path& p, uint64_t signature, std::string& err);
+    void FlushLocked();
+
+    std::ofstream out;
+    struct Completed
+    {
+        uint64_t stamp;
+        ScanResult result;
+    };
+
+    std::unordered_map<uint64_t, Completed> completed;
+    size_t restored;
+
+    std::mutex mutex;
+    std::string pending;
+    std::chrono::steady_clock::time_point last_flush;
+};
+}
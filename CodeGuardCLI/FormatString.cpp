@@ -0,0 +1,222 @@
+#include "FormatString.h"
+
+#include <cctype>
+
+namespace codeguard
+{
+const std::vector<FormatFunction>& FormatFunctionTable()
+{
+    static const std::vector<FormatFunction> table = {
+        { "scanf", 0, false, FormatFamily::Scan, false },
+        { "fscanf", 1, false, FormatFamily::Scan, false },
+        { "sscanf", 1, false, FormatFamily::Scan, false },
+        { "vscanf", 0, false, FormatFamily::Scan, false },
+        { "vfscanf", 1, false, FormatFamily::Scan, false },
+        { "vsscanf", 1, false, FormatFamily::Scan, false },
+        { "_snscanf", 2, false, FormatFamily::Scan, false },
+        { "wscanf", 0, true, FormatFamily::Scan, false },
+        { "fwscanf", 1, true, FormatFamily::Scan, false },
+        { "swscanf", 1, true, FormatFamily::Scan, false },
+        { "vwscanf", 0, true, FormatFamily::Scan, false },
+        { "vfwscanf", 1, true, FormatFamily::Scan, false },
+        { "vswscanf", 1, true, FormatFamily::Scan, false },
+        { "_snwscanf", 2, true, FormatFamily::Scan, false },
+        { "scanf_s", 0, false, FormatFamily::Scan, true },
+        { "fscanf_s", 1, false, FormatFamily::Scan, true },
+        { "sscanf_s", 1, false, FormatFamily::Scan, true },
+        { "vscanf_s", 0, false, FormatFamily::Scan, true },
+        { "vfscanf_s", 1, false, FormatFamily::Scan, true },
+        { "vsscanf_s", 1, false, FormatFamily::Scan, true },
+        { "_snscanf_s", 2, false, FormatFamily::Scan, true },
+        { "wscanf_s", 0, true, FormatFamily::Scan, true },
+        { "fwscanf_s", 1, true, FormatFamily::Scan, true },
+        { "swscanf_s", 1, true, FormatFamily::Scan, true },
+        { "vwscanf_s", 0, true, FormatFamily::Scan, true },
+        { "vfwscanf_s", 1, true, FormatFamily::Scan, true },
+        { "vswscanf_s", 1, true, FormatFamily::Scan, true },
+        { "_snwscanf_s", 2, true, FormatFamily::Scan, true },
+        { "printf", 0, false, FormatFamily::Print, false },
+        { "fprintf", 1, false, FormatFamily::Print, false },
+        { "sprintf", 1, false, FormatFamily::Print, false },
+        { "snprintf", 2, false, FormatFamily::Print, false },
+        { "_snprintf", 2, false, FormatFamily::Print, false },
+        { "vprintf", 0, false, FormatFamily::Print, false },
+        { "vfprintf", 1, false, FormatFamily::Print, false },
+        { "vsprintf", 1, false, FormatFamily::Print, false },
+        { "vsnprintf", 2, false, FormatFamily::Print, false },
+        { "_vsnprintf", 2, false, FormatFamily::Print, false },
+        { "wprintf", 0, true, FormatFamily::Print, false },
+        { "fwprintf", 1, true, FormatFamily::Print, false },
+        { "swprintf", 2, true, FormatFamily::Print, false },
+        { "_snwprintf", 2, true, FormatFamily::Print, false },
+        { "vwprintf", 0, true, FormatFamily::Print, false },
+        { "vfwprintf", 1, true, FormatFamily::Print, false },
+        { "vswprintf", 2, true, FormatFamily::Print, false },
+        { "printf_s", 0, false, FormatFamily::Print, true },
+        { "fprintf_s", 1, false, FormatFamily::Print, true },
+        { "sprintf_s", 2, false, FormatFamily::Print, true },
+        { "wprintf_s", 0, true, FormatFamily::Print, true },
+        { "fwprintf_s", 1, true, FormatFamily::Print, true },
+        { "swprintf_s", 2, true, FormatFamily::Print, true }
+    };
+    return table;
+}
+
+static size_t SkipDigits(std::string_view s, size_t i)
+{
+    while (i < s.size() && std::isdigit(static_cast<unsigned char>(s[i])))
+    {
+        i++;
+    }
+    return i;
+}
+
+static size_t SkipPositional(std::string_view s, size_t i)
+{
+    const size_t j = SkipDigits(s, i);
+    if (j > i && j < s.size() && s[j] == '$')
+    {
+        return j + 1;
+    }
+    return i;
+}
+
+static size_t SkipLengthModifier(std::string_view s, size_t i)
+{
+    if (i >= s.size())
+    {
+        return i;
+    }
+
+    const char c = s[i];
+    if (c == 'h' || c == 'l')
+    {
+        i++;
+        if (i < s.size() && s[i] == c)
+        {
+            i++;
+        }
+        return i;
+    }
+    if (c == 'j' || c == 'z' || c == 't' || c == 'L' || c == 'w')
+    {
+        return i + 1;
+    }
+    if (c == 'I')
+    {
+        i++;
+        if (s.compare(i, 2, "32") == 0 || s.compare(i, 2, "64") == 0)
+        {
+            i += 2;
+        }
+        return i;
+    }
+    return i;
+}
+
+std::vector<FormatSpec> ParseFormatString(std::string_view fmt, FormatFamily family)
+{
+    std::vector<FormatSpec> specs;
+
+    for (size_t i = 0; i < fmt.size(); i++)
+    {
+        if (fmt[i] != '%')
+        {
+            continue;
+        }
+
+        if (i + 1 < fmt.size() && fmt[i + 1] == '%')
+        {
+            i++;
+            continue;
+        }
+
+        FormatSpec spec;
+        spec.offset = i;
+        spec.conversion = '\0';
+        spec.suppressed = false;
+        spec.has_width = false;
+
+        i++;
+        i = SkipPositional(fmt, i);
+
+        if (family == FormatFamily::Scan)
+        {
+            if (i < fmt.size() && fmt[i] == '*')
+            {
+                spec.suppressed = true;
+                i++;
+            }
+
+            const size_t w = SkipDigits(fmt, i);
+            spec.has_width = (w > i);
+            i = w;
+        }
+        else
+        {
+            while (i < fmt.size() && (fmt[i] == '-' || fmt[i] == '+' || fmt[i] == ' ' || fmt[i] == '#' || fmt[i] == '0' || fmt[i] == '\''))
+            {
+                i++;
+            }
+
+            if (i < fmt.size() && fmt[i] == '*')
+            {
+                spec.has_width = true;
+                i = SkipPositional(fmt, i + 1);
+            }
+            else
+            {
+                const size_t w = SkipDigits(fmt, i);
+                spec.has_width = (w > i);
+                i = w;
+            }
+
+            if (i < fmt.size() && fmt[i] == '.')
+            {
+                i++;
+                if (i < fmt.size() && fmt[i] == '*')
+                {
+                    i = SkipPositional(fmt, i + 1);
+                }
+                else
+                {
+                    i = SkipDigits(fmt, i);
+                }
+            }
+        }
+
+        i = SkipLengthModifier(fmt, i);
+
+        if (i >= fmt.size())
+        {
+            break;
+        }
+
+        spec.conversion = fmt[i];
+
+        if (family == FormatFamily::Scan && spec.conversion == '[')
+        {
+            const size_t setStart = i + 1;
+            size_t j = setStart;
+            if (j < fmt.size() && fmt[j] == '^')
+            {
+                j++;
+            }
+            if (j < fmt.size() && fmt[j] == ']')
+            {
+                j++;
+            }
+            while (j < fmt.size() && fmt[j] != ']')
+            {
+                j++;
+            }
+            spec.scanset = std::string(fmt.substr(setStart, j - setStart));
+            i = (j < fmt.size()) ? j : fmt.size() - 1;
+        }
+
+        specs.push_back(std::move(spec));
+    }
+
+    return specs;
+}
+}
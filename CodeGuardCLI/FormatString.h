@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codeguard
+{
+enum class FormatFamily
+{
+    Print,
+    Scan
+};
+
+struct FormatFunction
+{
+    const char* name;
+    size_t format_arg;
+    bool wide;
+    FormatFamily family;
+    bool bounded;
+};
+
+struct FormatSpec
+{
+    size_t offset;
+    char conversion;
+    bool suppressed;
+    bool has_width;
+    std::string scanset;
+};
+
+const std::vector<FormatFunction>& FormatFunctionTable();
+
+// Parses printf/scanf conversion specifications; scansets are reported with conversion '['.
+std::vector<FormatSpec> ParseFormatString(std::string_view fmt, FormatFamily family);
+}
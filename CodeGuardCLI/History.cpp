@@ -0,0 +1,132 @@
+#include "History.h"
+
+#include "Util.h"
+
+#include <fstream>
+#include <algorithm>
+#include <vector>
+
+namespace codeguard
+{
+static const char kHistoryMagic[4] = { 'C', 'G', 'H', 'S' };
+static const uint32_t kHistoryVersion = 1;
+
+ScanHistory::ScanHistory()
+{
+    scores.clear();
+}
+
+bool ScanHistory::Load(const std::filesystem::path& p, std::string& err)
+{
+    err.clear();
+    scores.clear();
+
+    std::ifstream f(p, std::ios::binary);
+    if (!f)
+    {
+        err = "failed to open history";
+        return false;
+    }
+
+    unsigned char header[16];
+    f.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!f || !std::equal(kHistoryMagic, kHistoryMagic + 4, reinterpret_cast<const char*>(header)))
+    {
+        err = "not a history file";
+        return false;
+    }
+
+    if (LoadLE(header + 4, 4) != kHistoryVersion)
+    {
+        err = "unsupported history version";
+        return false;
+    }
+
+    // The header count is untrusted; it must describe exactly the entries that follow.
+    const uint64_t n = LoadLE(header + 8, 8);
+    std::error_code ec;
+    const uintmax_t size = std::filesystem::file_size(p, ec);
+    if (ec || (size - 16) % 12 != 0 || (size - 16) / 12 != n)
+    {
+        err = "corrupt history";
+        return false;
+    }
+    scores.reserve(static_cast<size_t>(n));
+
+    unsigned char entry[12];
+    for (uint64_t i = 0; i < n; i++)
+    {
+        f.read(reinterpret_cast<char*>(entry), sizeof(entry));
+        if (!f)
+        {
+            err = "truncated history";
+            return false;
+        }
+        scores[LoadLE(entry, 8)] = static_cast<uint32_t>(LoadLE(entry + 8, 4));
+    }
+
+    return true;
+}
+
+bool ScanHistory::Save(const std::filesystem::path& p, std::string& err) const
+{
+    err.clear();
+
+    std::vector<std::pair<uint64_t, uint32_t>> entries(scores.begin(), scores.end());
+    std::sort(entries.begin(), entries.end());
+
+    std::string out;
+    out.reserve(16 + entries.size() * 12);
+    out.append(kHistoryMagic, 4);
+    AppendU32(out, kHistoryVersion);
+    AppendU64(out, static_cast<uint64_t>(entries.size()));
+    for (const auto& e : entries)
+    {
+        AppendU64(out, e.first);
+        AppendU32(out, e.second);
+    }
+
+    std::ofstream f(p, std::ios::binary | std::ios::trunc);
+    if (!f)
+    {
+        err = "failed to create history";
+        return false;
+    }
+    f.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!f)
+    {
+        err = "failed to write history";
+        return false;
+    }
+    return true;
+}
+
+uint32_t ScanHistory::Score(uint64_t path_key) const
+{
+    const auto it = scores.find(path_key);
+    return (it != scores.end()) ? it->second : 0;
+}
+
+// Halves the old score each scan so stale hits fade out while repeat offenders stay on top.
+void ScanHistory::Record(uint64_t path_key, uint64_t findings)
+{
+    const uint32_t old = Score(path_key);
+    const uint32_t score = old / 2 + static_cast<uint32_t>(std::min<uint64_t>(findings, 64)) * 16;
+    if (score == 0)
+    {
+        scores.erase(path_key);
+        return;
+    }
+    scores[path_key] = score;
+}
+
+size_t ScanHistory::Size() const
+{
+    return scores.size();
+}
+
+uint64_t ScanHistory::PathKey(const std::filesystem::path& p, const std::filesystem::path& root)
+{
+    return HashBytes(NormalizeRelativePath(p, root), 0);
+}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+
+namespace codeguard
+{
+// Per-path finding history used to schedule likely-failing files first.
+class ScanHistory final
+{
+public:
+    ScanHistory();
+
+    bool Load(const std::filesystem::path& p, std::string& err);
+    bool Save(const std::filesystem::path& p, std::string& err) const;
+
+    uint32_t Score(uint64_t path_key) const;
+    void Record(uint64_t path_key, uint64_t findings);
+    size_t Size() const;
+
+    static uint64_t PathKey(const std::filesystem::path& p, const std::filesystem::path& root);
+
+private:
+    std::unordered_map<uint64_t, uint32_t> scores;
+};
+}
@@ -0,0 +1,609 @@
+#include "Inflate.h"
+
+#include <vector>
+
+namespace codeguard
+{
+static const int kMaxBits = 15;
+static const size_t kWindowSize = 32768;
+static const size_t kOutputChunk = 65536;
+
+static const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t kDistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static uint32_t Crc32Update(uint32_t crc, const unsigned char* p, size_t n)
+{
+    static const std::vector<uint32_t> table = []()
+    {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++)
+    {
+        crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Canonical Huffman code in the compact count/symbol form used by RFC 1951 decoders.
+struct Huffman
+{
+    uint16_t count[kMaxBits + 1];
+    uint16_t symbol[288];
+};
+
+class Inflater final
+{
+public:
+    Inflater(std::istream& in, const InflateSink& sink)
+        : input(in), output_sink(sink)
+    {
+        in_buf.resize(65536);
+        in_pos = 0;
+        in_len = 0;
+        bit_buf = 0;
+        bit_cnt = 0;
+        failed = false;
+        stopped = false;
+        window.assign(kWindowSize, 0);
+        window_pos = 0;
+        total_out = 0;
+        crc = 0;
+        out_buf.reserve(kOutputChunk);
+    }
+
+    bool RunGzip(std::string& err);
+
+private:
+    std::istream& input;
+    const InflateSink& output_sink;
+
+    std::vector<char> in_buf;
+    size_t in_pos;
+    size_t in_len;
+    uint32_t bit_buf;
+    int bit_cnt;
+    bool failed;
+    bool stopped;
+
+    std::vector<unsigned char> window;
+    size_t window_pos;
+    uint64_t total_out;
+    uint32_t crc;
+    std::string out_buf;
+
+    int NextByte();
+    uint32_t Bits(int need);
+    void AlignToByte();
+
+    void Put(unsigned char c);
+    bool Flush();
+
+    static bool Build(Huffman& h, const uint8_t* lengths, int n);
+    int Decode(const Huffman& h);
+
+    bool Stored(std::string& err);
+    bool Codes(const Huffman& lencode, const Huffman& distcode, std::string& err);
+    bool Fixed(std::string& err);
+    bool Dynamic(std::string& err);
+    bool Deflate(std::string& err);
+    bool Header(bool after_member, bool& eof, std::string& err);
+};
+
+int Inflater::NextByte()
+{
+    if (in_pos >= in_len)
+    {
+        input.read(in_buf.data(), static_cast<std::streamsize>(in_buf.size()));
+        in_len = static_cast<size_t>(input.gcount());
+        in_pos = 0;
+        if (in_len == 0)
+        {
+            return -1;
+        }
+    }
+    return static_cast<unsigned char>(in_buf[in_pos++]);
+}
+
+uint32_t Inflater::Bits(int need)
+{
+    uint32_t val = bit_buf;
+    while (bit_cnt < need)
+    {
+        const int b = NextByte();
+        if (b < 0)
+        {
+            failed = true;
+            return 0;
+        }
+        val |= static_cast<uint32_t>(b) << bit_cnt;
+        bit_cnt += 8;
+    }
+    bit_buf = (need == 32) ? 0 : (val >> need);
+    bit_cnt -= need;
+    return (need == 32) ? val : (val & ((1u << need) - 1));
+}
+
+void Inflater::AlignToByte()
+{
+    bit_buf = 0;
+    bit_cnt = 0;
+}
+
+void Inflater::Put(unsigned char c)
+{
+    window[window_pos] = c;
+    window_pos = (window_pos + 1) & (kWindowSize - 1);
+    total_out++;
+    out_buf.push_back(static_cast<char>(c));
+    if (out_buf.size() >= kOutputChunk)
+    {
+        Flush();
+    }
+}
+
+bool Inflater::Flush()
+{
+    if (out_buf.empty() || stopped)
+    {
+        out_buf.clear();
+        return !stopped;
+    }
+    crc = Crc32Update(crc, reinterpret_cast<const unsigned char*>(out_buf.data()), out_buf.size());
+    if (!output_sink(out_buf.data(), out_buf.size()))
+    {
+        stopped = true;
+    }
+    out_buf.clear();
+    return !stopped;
+}
+
+bool Inflater::Build(Huffman& h, const uint8_t* lengths, int n)
+{
+    for (int len = 0; len <= kMaxBits; len++)
+    {
+        h.count[len] = 0;
+    }
+    for (int s = 0; s < n; s++)
+    {
+        h.count[lengths[s]]++;
+    }
+    if (h.count[0] == n)
+    {
+        return true;
+    }
+
+    int left = 1;
+    for (int len = 1; len <= kMaxBits; len++)
+    {
+        left <<= 1;
+        left -= h.count[len];
+        if (left < 0)
+        {
+            return false;
+        }
+    }
+
+    uint16_t offs[kMaxBits + 1];
+    offs[1] = 0;
+    for (int len = 1; len < kMaxBits; len++)
+    {
+        offs[len + 1] = static_cast<uint16_t>(offs[len] + h.count[len]);
+    }
+    for (int s = 0; s < n; s++)
+    {
+        if (lengths[s] != 0)
+        {
+            h.symbol[offs[lengths[s]]++] = static_cast<uint16_t>(s);
+        }
+    }
+    return true;
+}
+
+int Inflater::Decode(const Huffman& h)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len <= kMaxBits; len++)
+    {
+        code |= static_cast<int>(Bits(1));
+        if (failed)
+        {
+            return -1;
+        }
+        const int count = h.count[len];
+        if (code - count < first)
+        {
+            return h.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool Inflater::Stored(std::string& err)
+{
+    AlignToByte();
+
+    int b[4];
+    for (auto& v : b)
+    {
+        v = NextByte();
+        if (v < 0)
+        {
+            err = "truncated stored block";
+            return false;
+        }
+    }
+
+    const uint32_t len = static_cast<uint32_t>(b[0] | (b[1] << 8));
+    const uint32_t nlen = static_cast<uint32_t>(b[2] | (b[3] << 8));
+    if (len != (~nlen & 0xffff))
+    {
+        err = "corrupt stored block";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        const int c = NextByte();
+        if (c < 0)
+        {
+            err = "truncated stored block";
+            return false;
+        }
+        Put(static_cast<unsigned char>(c));
+    }
+    return true;
+}
+
+bool Inflater::Codes(const Huffman& lencode, const Huffman& distcode, std::string& err)
+{
+    while (!stopped)
+    {
+        int symbol = Decode(lencode);
+        if (symbol < 0)
+        {
+            err = "corrupt deflate data";
+            return false;
+        }
+
+        if (symbol < 256)
+        {
+            Put(static_cast<unsigned char>(symbol));
+            continue;
+        }
+        if (symbol == 256)
+        {
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29)
+        {
+            err = "invalid length code";
+            return false;
+        }
+        const uint32_t len = kLengthBase[symbol] + Bits(kLengthExtra[symbol]);
+
+        symbol = Decode(distcode);
+        if (symbol < 0 || symbol >= 30)
+        {
+            err = "invalid distance code";
+            return false;
+        }
+        const uint32_t dist = kDistBase[symbol] + Bits(kDistExtra[symbol]);
+        if (failed || dist > total_out || dist > kWindowSize)
+        {
+            err = "invalid distance";
+            return false;
+        }
+
+        size_t from = (window_pos + kWindowSize - dist) & (kWindowSize - 1);
+        for (uint32_t i = 0; i < len; i++)
+        {
+            Put(window[from]);
+            from = (from + 1) & (kWindowSize - 1);
+        }
+    }
+    return true;
+}
+
+bool Inflater::Fixed(std::string& err)
+{
+    static Huffman lencode;
+    static Huffman distcode;
+    static const bool built = []()
+    {
+        uint8_t lengths[288];
+        int s = 0;
+        for (; s < 144; s++)
+        {
+            lengths[s] = 8;
+        }
+        for (; s < 256; s++)
+        {
+            lengths[s] = 9;
+        }
+        for (; s < 280; s++)
+        {
+            lengths[s] = 7;
+        }
+        for (; s < 288; s++)
+        {
+            lengths[s] = 8;
+        }
+        Build(lencode, lengths, 288);
+
+        for (s = 0; s < 30; s++)
+        {
+            lengths[s] = 5;
+        }
+        Build(distcode, lengths, 30);
+        return true;
+    }();
+    (void)built;
+
+    return Codes(lencode, distcode, err);
+}
+
+bool Inflater::Dynamic(std::string& err)
+{
+    static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    const int nlen = static_cast<int>(Bits(5)) + 257;
+    const int ndist = static_cast<int>(Bits(5)) + 1;
+    const int ncode = static_cast<int>(Bits(4)) + 4;
+    if (failed || nlen > 286 || ndist > 30)
+    {
+        err = "bad dynamic block counts";
+        return false;
+    }
+
+    uint8_t lengths[320] = {};
+    for (int i = 0; i < ncode; i++)
+    {
+        lengths[order[i]] = static_cast<uint8_t>(Bits(3));
+    }
+
+    Huffman lencode;
+    Huffman distcode;
+    if (!Build(lencode, lengths, 19))
+    {
+        err = "bad code length code";
+        return false;
+    }
+
+    int index = 0;
+    while (index < nlen + ndist)
+    {
+        int symbol = Decode(lencode);
+        if (symbol < 0)
+        {
+            err = "corrupt code lengths";
+            return false;
+        }
+        if (symbol < 16)
+        {
+            lengths[index++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t len = 0;
+        int repeat = 0;
+        if (symbol == 16)
+        {
+            if (index == 0)
+            {
+                err = "repeat with no previous length";
+                return false;
+            }
+            len = lengths[index - 1];
+            repeat = 3 + static_cast<int>(Bits(2));
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + static_cast<int>(Bits(3));
+        }
+        else
+        {
+            repeat = 11 + static_cast<int>(Bits(7));
+        }
+
+        if (index + repeat > nlen + ndist)
+        {
+            err = "too many code lengths";
+            return false;
+        }
+        while (repeat-- > 0)
+        {
+            lengths[index++] = len;
+        }
+    }
+
+    if (failed || lengths[256] == 0)
+    {
+        err = "missing end-of-block code";
+        return false;
+    }
+
+    if (!Build(lencode, lengths, nlen) || !Build(distcode, lengths + nlen, ndist))
+    {
+        err = "bad literal/length or distance code";
+        return false;
+    }
+
+    return Codes(lencode, distcode, err);
+}
+
+bool Inflater::Deflate(std::string& err)
+{
+    bool last = false;
+    while (!last && !stopped)
+    {
+        last = Bits(1) != 0;
+        const uint32_t type = Bits(2);
+        if (failed)
+        {
+            err = "truncated deflate stream";
+            return false;
+        }
+
+        bool ok = false;
+        if (type == 0)
+        {
+            ok = Stored(err);
+        }
+        else if (type == 1)
+        {
+            ok = Fixed(err);
+        }
+        else if (type == 2)
+        {
+            ok = Dynamic(err);
+        }
+        else
+        {
+            err = "invalid block type";
+        }
+
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Inflater::Header(bool after_member, bool& eof, std::string& err)
+{
+    eof = false;
+
+    // Zero padding after the last member is common in tarballs.
+    const int id1 = NextByte();
+    if (id1 < 0 || (after_member && id1 == 0))
+    {
+        eof = true;
+        return true;
+    }
+    const int id2 = NextByte();
+    const int cm = NextByte();
+    const int flg = NextByte();
+    if (id1 != 0x1f || id2 != 0x8b || cm != 8 || flg < 0)
+    {
+        err = "not a gzip stream";
+        return false;
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        NextByte();
+    }
+
+    if (flg & 0x04)
+    {
+        const int lo = NextByte();
+        const int hi = NextByte();
+        const int xlen = (lo < 0 || hi < 0) ? 0 : (lo | (hi << 8));
+        for (int i = 0; i < xlen; i++)
+        {
+            NextByte();
+        }
+    }
+    if (flg & 0x08)
+    {
+        int c;
+        while ((c = NextByte()) > 0)
+        {
+        }
+    }
+    if (flg & 0x10)
+    {
+        int c;
+        while ((c = NextByte()) > 0)
+        {
+        }
+    }
+    if (flg & 0x02)
+    {
+        NextByte();
+        NextByte();
+    }
+    return true;
+}
+
+bool Inflater::RunGzip(std::string& err)
+{
+    bool any = false;
+    while (!stopped)
+    {
+        bool eof = false;
+        if (!Header(any, eof, err))
+        {
+            return false;
+        }
+        if (eof)
+        {
+            break;
+        }
+
+        crc = 0;
+        total_out = 0;
+        if (!Deflate(err))
+        {
+            return false;
+        }
+        Flush();
+        if (stopped)
+        {
+            break;
+        }
+
+        AlignToByte();
+        uint32_t trailer[8];
+        for (auto& v : trailer)
+        {
+            const int b = NextByte();
+            if (b < 0)
+            {
+                err = "truncated gzip trailer";
+                return false;
+            }
+            v = static_cast<uint32_t>(b);
+        }
+        const uint32_t expectCrc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (trailer[3] << 24);
+        const uint32_t expectSize = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | (trailer[7] << 24);
+        if (expectCrc != crc || expectSize != static_cast<uint32_t>(total_out))
+        {
+            err = "gzip checksum mismatch";
+            return false;
+        }
+        any = true;
+    }
+    return true;
+}
+
+bool GunzipStream(std::istream& in, const InflateSink& sink, std::string& err)
+{
+    err.clear();
+    Inflater inflater(in, sink);
+    return inflater.RunGzip(err);
+}
+}
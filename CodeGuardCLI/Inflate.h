@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <functional>
+
+namespace codeguard
+{
+// Receives decompressed bytes in order; return false to stop decoding early.
+using InflateSink = std::function<bool(const char* data, size_t size)>;
+
+// Streams a (possibly multi-member) gzip file through sink with a 32 KB window; memory use does not depend on file size.
+bool GunzipStream(std::istream& in, const InflateSink& sink, std::string& err);
+}
@@ -0,0 +1,251 @@
+#include "Metrics.h"
+
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace codeguard
+{
+static const uint64_t kLatencyBoundsNs[ScanMetrics::kLatencyBucketCount] = {
+    50000ull,
+    100000ull,
+    250000ull,
+    500000ull,
+    1000000ull,
+    2500000ull,
+    10000000ull,
+    50000000ull,
+    250000000ull,
+    1000000000ull
+};
+
+static const char* const kSkipReasonNames[] = {
+    "none",
+    "binary",
+    "generated",
+    "unreadable"
+};
+
+static const char* SeverityLabel(Severity s)
+{
+    switch (s)
+    {
+        case Severity::Low: return "low";
+        case Severity::Medium: return "medium";
+        case Severity::High: return "high";
+        default: return "unknown";
+    }
+}
+
+static std::string Seconds(uint64_t ns)
+{
+    std::ostringstream os;
+    os << (static_cast<double>(ns) / 1e9);
+    return os.str();
+}
+
+static void Header(std::ostringstream& os, const char* name, const char* type, const char* help)
+{
+    os << "# HELP " << name << " " << help << "\n";
+    os << "# TYPE " << name << " " << type << "\n";
+}
+
+ScanMetrics::ScanMetrics()
+    : shards(new Shard[kShardCount])
+{
+    scans_total = 0;
+    last_duration_ns = 0;
+    last_findings = 0;
+    last_files_seen = 0;
+}
+
+ScanMetrics::~ScanMetrics() = default;
+
+ScanMetrics::Shard& ScanMetrics::LocalShard()
+{
+    static std::atomic<size_t> next_shard(0);
+    thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+    return shards[shard];
+}
+
+void ScanMetrics::RecordFile(const ScanResult& file_result, SkipReason skipped, uint64_t elapsed_ns)
+{
+    Shard& s = LocalShard();
+    const ScanStats& st = file_result.stats;
+
+    s.files_scanned.fetch_add(st.files_scanned, std::memory_order_relaxed);
+    s.files_prefiltered.fetch_add(st.files_prefiltered, std::memory_order_relaxed);
+    s.bytes_scanned.fetch_add(st.bytes_scanned, std::memory_order_relaxed);
+    s.archives_scanned.fetch_add(st.archives_scanned, std::memory_order_relaxed);
+    s.archives_unreadable.fetch_add(st.archives_unreadable, std::memory_order_relaxed);
+    s.findings_suppressed.fetch_add(st.findings_suppressed, std::memory_order_relaxed);
+    s.findings_baselined.fetch_add(st.findings_baselined, std::memory_order_relaxed);
+
+    if (skipped != SkipReason::None)
+    {
+        s.skipped[static_cast<size_t>(skipped)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t bucket = 0;
+    while (bucket < kLatencyBucketCount && elapsed_ns > kLatencyBoundsNs[bucket])
+    {
+        bucket++;
+    }
+    s.latency_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    s.latency_sum_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+
+    if (!file_result.findings.empty())
+    {
+        std::lock_guard<std::mutex> lock(s.findings_mutex);
+        for (const auto& f : file_result.findings)
+        {
+            s.findings[{ f.rule_id, f.severity }]++;
+        }
+    }
+}
+
+void ScanMetrics::RecordRun(const ScanResult& result, uint64_t elapsed_ns)
+{
+    std::lock_guard<std::mutex> lock(run_mutex);
+    scans_total++;
+    last_duration_ns = elapsed_ns;
+    last_findings = result.stats.findings;
+    last_files_seen = result.stats.files_seen;
+}
+
+std::string ScanMetrics::Render() const
+{
+    uint64_t files_scanned = 0;
+    uint64_t files_prefiltered = 0;
+    uint64_t bytes_scanned = 0;
+    uint64_t archives_scanned = 0;
+    uint64_t archives_unreadable = 0;
+    uint64_t findings_suppressed = 0;
+    uint64_t findings_baselined = 0;
+    uint64_t skipped[4] = {};
+    uint64_t latency_buckets[kLatencyBucketCount + 1] = {};
+    uint64_t latency_sum_ns = 0;
+    std::map<std::pair<std::string, Severity>, uint64_t> findings;
+
+    for (size_t i = 0; i < kShardCount; i++)
+    {
+        const Shard& s = shards[i];
+        files_scanned += s.files_scanned.load(std::memory_order_relaxed);
+        files_prefiltered += s.files_prefiltered.load(std::memory_order_relaxed);
+        bytes_scanned += s.bytes_scanned.load(std::memory_order_relaxed);
+        archives_scanned += s.archives_scanned.load(std::memory_order_relaxed);
+        archives_unreadable += s.archives_unreadable.load(std::memory_order_relaxed);
+        findings_suppressed += s.findings_suppressed.load(std::memory_order_relaxed);
+        findings_baselined += s.findings_baselined.load(std::memory_order_relaxed);
+        for (size_t r = 0; r < 4; r++)
+        {
+            skipped[r] += s.skipped[r].load(std::memory_order_relaxed);
+        }
+        for (size_t b = 0; b <= kLatencyBucketCount; b++)
+        {
+            latency_buckets[b] += s.latency_buckets[b].load(std::memory_order_relaxed);
+        }
+        latency_sum_ns += s.latency_sum_ns.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(s.findings_mutex);
+        for (const auto& kv : s.findings)
+        {
+            findings[kv.first] += kv.second;
+        }
+    }
+
+    std::ostringstream os;
+
+    Header(os, "codeguard_files_scanned_total", "counter", "Files evaluated by the rules, including archive members.");
+    os << "codeguard_files_scanned_total " << files_scanned << "\n";
+
+    Header(os, "codeguard_files_prefiltered_total", "counter", "Scanned files that contained no rule trigger name.");
+    os << "codeguard_files_prefiltered_total " << files_prefiltered << "\n";
+
+    Header(os, "codeguard_bytes_scanned_total", "counter", "Bytes evaluated by the rules.");
+    os << "codeguard_bytes_scanned_total " << bytes_scanned << "\n";
+
+    Header(os, "codeguard_archives_scanned_total", "counter", "Archives read without extracting.");
+    os << "codeguard_archives_scanned_total " << archives_scanned << "\n";
+
+    Header(os, "codeguard_archives_unreadable_total", "counter", "Archives cut short by a truncated or corrupt tar/gzip stream.");
+    os << "codeguard_archives_unreadable_total " << archives_unreadable << "\n";
+
+    Header(os, "codeguard_files_skipped_total", "counter", "Candidate files not evaluated, by reason.");
+    for (size_t r = 1; r < 4; r++)
+    {
+        os << "codeguard_files_skipped_total{reason=\"" << kSkipReasonNames[r] << "\"} " << skipped[r] << "\n";
+    }
+
+    Header(os, "codeguard_findings_total", "counter", "Reported findings by rule and severity.");
+    for (const auto& kv : findings)
+    {
+        os << "codeguard_findings_total{rule_id=\"" << kv.first.first << "\",severity=\"" << SeverityLabel(kv.first.second) << "\"} " << kv.second << "\n";
+    }
+
+    Header(os, "codeguard_findings_suppressed_total", "counter", "Findings hidden by codeguard-ignore markers.");
+    os << "codeguard_findings_suppressed_total " << findings_suppressed << "\n";
+
+    Header(os, "codeguard_findings_baselined_total", "counter", "Findings hidden by the baseline.");
+    os << "codeguard_findings_baselined_total " << findings_baselined << "\n";
+
+    Header(os, "codeguard_file_scan_duration_seconds", "histogram", "Time to read and scan one candidate file.");
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b < kLatencyBucketCount; b++)
+    {
+        cumulative += latency_buckets[b];
+        os << "codeguard_file_scan_duration_seconds_bucket{le=\"" << Seconds(kLatencyBoundsNs[b]) << "\"} " << cumulative << "\n";
+    }
+    cumulative += latency_buckets[kLatencyBucketCount];
+    os << "codeguard_file_scan_duration_seconds_bucket{le=\"+Inf\"} " << cumulative << "\n";
+    os << "codeguard_file_scan_duration_seconds_sum " << Seconds(latency_sum_ns) << "\n";
+    os << "codeguard_file_scan_duration_seconds_count " << cumulative << "\n";
+
+    std::lock_guard<std::mutex> lock(run_mutex);
+
+    Header(os, "codeguard_scans_total", "counter", "Completed scan runs.");
+    os << "codeguard_scans_total " << scans_total << "\n";
+
+    Header(os, "codeguard_last_scan_duration_seconds", "gauge", "Wall time of the most recent scan run.");
+    os << "codeguard_last_scan_duration_seconds " << Seconds(last_duration_ns) << "\n";
+
+    Header(os, "codeguard_last_scan_findings", "gauge", "Findings reported by the most recent scan run.");
+    os << "codeguard_last_scan_findings " << last_findings << "\n";
+
+    Header(os, "codeguard_last_scan_files_seen", "gauge", "Directory entries visited by the most recent scan run.");
+    os << "codeguard_last_scan_files_seen " << last_files_seen << "\n";
+
+    return os.str();
+}
+
+bool ScanMetrics::WriteFile(const std::filesystem::path& p, std::string& err) const
+{
+    const std::string text = Render();
+
+    std::filesystem::path tmp = p;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f)
+        {
+            err = "failed to create metrics file";
+            return false;
+        }
+        f.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!f)
+        {
+            err = "failed to write metrics file";
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, p, ec);
+    if (ec)
+    {
+        err = "failed to replace metrics file";
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Scanner.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace codeguard
+{
+enum class SkipReason
+{
+    None,
+    Binary,
+    Generated,
+    Unreadable
+};
+
+// Counters and histograms for Prometheus text exposition.
+// Writers update a per-thread shard with relaxed atomics; Render() sums the shards, so readers never block the scan.
+class ScanMetrics final
+{
+public:
+    ScanMetrics();
+    ~ScanMetrics();
+
+    ScanMetrics(const ScanMetrics&) = delete;
+    ScanMetrics& operator=(const ScanMetrics&) = delete;
+
+    void RecordFile(const ScanResult& file_result, SkipReason skipped, uint64_t elapsed_ns);
+    void RecordRun(const ScanResult& result, uint64_t elapsed_ns);
+
+    std::string Render() const;
+
+    // Writes through a temporary file and renames it, so a collector never reads a partial file.
+    bool WriteFile(const std::filesystem::path& p, std::string& err) const;
+
+    static constexpr size_t kShardCount = 32;
+    static constexpr size_t kLatencyBucketCount = 10;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> files_scanned{ 0 };
+        std::atomic<uint64_t> files_prefiltered{ 0 };
+        std::atomic<uint64_t> bytes_scanned{ 0 };
+        std::atomic<uint64_t> archives_scanned{ 0 };
+        std::atomic<uint64_t> archives_unreadable{ 0 };
+        std::atomic<uint64_t> findings_suppressed{ 0 };
+        std::atomic<uint64_t> findings_baselined{ 0 };
+        std::atomic<uint64_t> skipped[4] = {};
+        std::atomic<uint64_t> latency_buckets[kLatencyBucketCount + 1] = {};
+        std::atomic<uint64_t> latency_sum_ns{ 0 };
+
+        // Only taken for files with findings; each thread normally owns its shard, so it is uncontended.
+        mutable std::mutex findings_mutex;
+        std::map<std::pair<std::string, Severity>, uint64_t> findings;
+    };
+
+    Shard& LocalShard();
+
+    std::unique_ptr<Shard[]> shards;
+
+    mutable std::mutex run_mutex;
+    uint64_t scans_total;
+    uint64_t last_duration_ns;
+    uint64_t last_findings;
+    uint64_t last_files_seen;
+};
+}
@@ -0,0 +1,157 @@
+#include "MetricsServer.h"
+
+#include "Metrics.h"
+
+#define NOMINMAX
+#include <winsock2.h>
+
+namespace codeguard
+{
+static void SendAll(SOCKET s, const std::string& data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        const int n = send(s, data.data() + sent, static_cast<int>(data.size() - sent), 0);
+        if (n <= 0)
+        {
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+static std::string HttpResponse(const char* status, const char* content_type, const std::string& body)
+{
+    std::string r = "HTTP/1.1 ";
+    r += status;
+    r += "\r\nContent-Type: ";
+    r += content_type;
+    r += "\r\nContent-Length: " + std::to_string(body.size());
+    r += "\r\nConnection: close\r\n\r\n";
+    r += body;
+    return r;
+}
+
+MetricsServer::MetricsServer()
+{
+    metrics = nullptr;
+    listen_socket = static_cast<uintptr_t>(INVALID_SOCKET);
+    wsa_started = false;
+    stopping.store(false);
+}
+
+MetricsServer::~MetricsServer()
+{
+    Stop();
+}
+
+bool MetricsServer::Start(uint16_t port, const ScanMetrics& m, std::string& err)
+{
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+    {
+        err = "failed to initialize winsock";
+        return false;
+    }
+    wsa_started = true;
+
+    const SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+    {
+        err = "failed to create socket";
+        Stop();
+        return false;
+    }
+    listen_socket = static_cast<uintptr_t>(s);
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (bind(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR || listen(s, 8) == SOCKET_ERROR)
+    {
+        err = "failed to listen on port " + std::to_string(port);
+        Stop();
+        return false;
+    }
+
+    metrics = &m;
+    stopping.store(false);
+    thread = std::thread([this]() { Serve(); });
+    return true;
+}
+
+void MetricsServer::Stop()
+{
+    stopping.store(true);
+
+    // Closing the listening socket is what wakes the blocked accept().
+    if (listen_socket != static_cast<uintptr_t>(INVALID_SOCKET))
+    {
+        closesocket(static_cast<SOCKET>(listen_socket));
+        listen_socket = static_cast<uintptr_t>(INVALID_SOCKET);
+    }
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+
+    if (wsa_started)
+    {
+        WSACleanup();
+        wsa_started = false;
+    }
+}
+
+void MetricsServer::Serve()
+{
+    const SOCKET listener = static_cast<SOCKET>(listen_socket);
+
+    while (!stopping.load())
+    {
+        const SOCKET c = accept(listener, nullptr, nullptr);
+        if (c == INVALID_SOCKET)
+        {
+            if (stopping.load())
+            {
+                break;
+            }
+            continue;
+        }
+
+        const DWORD timeout_ms = 2000;
+        setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout_ms), sizeof(timeout_ms));
+
+        // Only the request line matters; read until the end of the headers or a small cap.
+        std::string request;
+        char buf[1024];
+        while (request.size() < 8192 && request.find("\r\n\r\n") == std::string::npos)
+        {
+            const int n = recv(c, buf, static_cast<int>(sizeof(buf)), 0);
+            if (n <= 0)
+            {
+                break;
+            }
+            request.append(buf, static_cast<size_t>(n));
+        }
+
+        if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0)
+        {
+            SendAll(c, HttpResponse("200 OK", "text/plain; version=0.0.4", metrics->Render()));
+        }
+        else if (request.rfind("GET ", 0) == 0)
+        {
+            SendAll(c, HttpResponse("404 Not Found", "text/plain", "not found\n"));
+        }
+        else
+        {
+            SendAll(c, HttpResponse("405 Method Not Allowed", "text/plain", "method not allowed\n"));
+        }
+
+        closesocket(c);
+    }
+}
+}
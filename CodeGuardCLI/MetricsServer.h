@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace codeguard
+{
+class ScanMetrics;
+
+// Serves GET /metrics on 127.0.0.1 from a background thread until Stop() or destruction.
+class MetricsServer final
+{
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool Start(uint16_t port, const ScanMetrics& metrics, std::string& err);
+    void Stop();
+
+private:
+    void Serve();
+
+    const ScanMetrics* metrics;
+    uintptr_t listen_socket;
+    bool wsa_started;
+    std::atomic<bool> stopping;
+    std::thread thread;
+};
+}
@@ -0,0 +1,114 @@
+#include "Prefilter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CODEGUARD_HAS_SSE2 1
+#endif
+
+namespace codeguard
+{
+void LiteralPrefilter::Build(const std::vector<std::string>& literals)
+{
+    std::vector<std::string> sorted;
+    for (const auto& s : literals)
+    {
+        if (!s.empty())
+        {
+            sorted.push_back(s);
+        }
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](const std::string& a, const std::string& b)
+    {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    });
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    anchors.clear();
+    max_anchor_size = 0;
+    for (const auto& s : sorted)
+    {
+        const bool covered = std::any_of(anchors.begin(), anchors.end(), [&](const std::string& a)
+        {
+            return s.find(a) != std::string::npos;
+        });
+        if (!covered)
+        {
+            anchors.push_back(s);
+            max_anchor_size = std::max(max_anchor_size, s.size());
+        }
+    }
+}
+
+const std::vector<std::string>& LiteralPrefilter::Anchors() const
+{
+    return anchors;
+}
+
+static bool MatchesAt(const char* p, const std::string& anchor)
+{
+    return std::memcmp(p, anchor.data(), anchor.size()) == 0;
+}
+
+void LiteralPrefilter::FindCandidates(std::string_view text, std::vector<size_t>& hits) const
+{
+    const size_t first_hit = hits.size();
+    const char* p = text.data();
+    const size_t n = text.size();
+    size_t i = 0;
+
+#if defined(CODEGUARD_HAS_SSE2)
+    // Compares the first and last byte of each anchor across 16 positions at once; only lanes
+    // where both agree are verified with memcmp. Stops early enough that every load stays in bounds.
+    if (!anchors.empty() && n >= max_anchor_size + 15)
+    {
+        const size_t limit = n - max_anchor_size - 15;
+        for (; i <= limit; i += 16)
+        {
+            const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            for (const auto& a : anchors)
+            {
+                const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + a.size() - 1));
+                const __m128i eq = _mm_and_si128(
+                    _mm_cmpeq_epi8(head, _mm_set1_epi8(a.front())),
+                    _mm_cmpeq_epi8(tail, _mm_set1_epi8(a.back()))
+                );
+
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(eq));
+                while (mask != 0)
+                {
+                    unsigned bit = 0;
+                    while (((mask >> bit) & 1u) == 0)
+                    {
+                        bit++;
+                    }
+                    mask &= mask - 1;
+
+                    if (MatchesAt(p + i + bit, a))
+                    {
+                        hits.push_back(i + bit);
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        for (const auto& a : anchors)
+        {
+            if (a.size() <= n - i && p[i] == a.front() && MatchesAt(p + i, a))
+            {
+                hits.push_back(i);
+            }
+        }
+    }
+
+    // Lanes are visited anchor by anchor, so hits within one block may be out of order.
+    std::sort(hits.begin() + static_cast<std::ptrdiff_t>(first_hit), hits.end());
+}
+}
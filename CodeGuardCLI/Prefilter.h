@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codeguard
+{
+// Multi-literal search over raw file bytes. A file with no candidate can skip sanitizing and all rules.
+class LiteralPrefilter final
+{
+public:
+    // Literals that contain another literal are folded into it ("sprintf" is covered by "printf").
+    void Build(const std::vector<std::string>& literals);
+
+    // Appends the offset of every anchor occurrence in text, in ascending order.
+    void FindCandidates(std::string_view text, std::vector<size_t>& hits) const;
+
+    const std::vector<std::string>& Anchors() const;
+
+private:
+    std::vector<std::string> anchors;
+    size_t max_anchor_size = 0;
+};
+}
@@ -0,0 +1,1317 @@
+#include "RegexRules.h"
+
+#include "Util.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+
+namespace codeguard
+{
+using ByteSet = std::bitset<256>;
+
+namespace
+{
+struct RegexNode
+{
+    enum class Kind
+    {
+        Set,
+        Empty,
+        Concat,
+        Alt,
+        Repeat
+    };
+
+    Kind kind;
+    int set;
+    std::vector<int> children;
+    int min;
+    int max;
+};
+
+constexpr int kUnbounded = -1;
+constexpr int kMaxRepeat = 64;
+
+class PatternParser
+{
+public:
+    PatternParser(const std::string& pattern, std::vector<RegexNode>& nodes, std::vector<ByteSet>& sets)
+        : p(pattern), nodes(nodes), sets(sets)
+    {
+        i = 0;
+        icase = false;
+    }
+
+    int Parse(std::string& err)
+    {
+        if (p.compare(0, 4, "(?i)") == 0)
+        {
+            icase = true;
+            i = 4;
+        }
+
+        const int root = ParseAlt();
+        if (root >= 0 && i < p.size())
+        {
+            Fail(p[i] == ')' ? "unbalanced ')'" : "unexpected character");
+        }
+        if (!error.empty())
+        {
+            err = error + " at offset " + std::to_string(i);
+            return -1;
+        }
+        return root;
+    }
+
+private:
+    const std::string& p;
+    std::vector<RegexNode>& nodes;
+    std::vector<ByteSet>& sets;
+    size_t i;
+    bool icase;
+    std::string error;
+
+    void Fail(const char* msg)
+    {
+        if (error.empty())
+        {
+            error = msg;
+        }
+    }
+
+    int Add(RegexNode::Kind kind, std::vector<int> children = {}, int set = -1, int min = 0, int max = 0)
+    {
+        nodes.push_back({ kind, set, std::move(children), min, max });
+        return static_cast<int>(nodes.size() - 1);
+    }
+
+    int AddSet(ByteSet s)
+    {
+        if (icase)
+        {
+            for (int c = 'a'; c <= 'z'; c++)
+            {
+                if (s[c] || s[c - 'a' + 'A'])
+                {
+                    s.set(c);
+                    s.set(c - 'a' + 'A');
+                }
+            }
+        }
+        sets.push_back(s);
+        return Add(RegexNode::Kind::Set, {}, static_cast<int>(sets.size() - 1));
+    }
+
+    int ParseAlt()
+    {
+        std::vector<int> alts;
+        alts.push_back(ParseConcat());
+        while (error.empty() && i < p.size() && p[i] == '|')
+        {
+            i++;
+            alts.push_back(ParseConcat());
+        }
+        return (alts.size() == 1) ? alts[0] : Add(RegexNode::Kind::Alt, std::move(alts));
+    }
+
+    int ParseConcat()
+    {
+        std::vector<int> items;
+        while (error.empty() && i < p.size() && p[i] != '|' && p[i] != ')')
+        {
+            items.push_back(ParseRepeat());
+        }
+        if (items.empty())
+        {
+            return Add(RegexNode::Kind::Empty);
+        }
+        return (items.size() == 1) ? items[0] : Add(RegexNode::Kind::Concat, std::move(items));
+    }
+
+    bool ParseNumber(int& out)
+    {
+        const size_t start = i;
+        out = 0;
+        while (i < p.size() && p[i] >= '0' && p[i] <= '9' && out <= kMaxRepeat)
+        {
+            out = out * 10 + (p[i] - '0');
+            i++;
+        }
+        return i > start;
+    }
+
+    int ParseRepeat()
+    {
+        int node = ParseAtom();
+        while (error.empty() && i < p.size())
+        {
+            int min = 0;
+            int max = 0;
+            const char c = p[i];
+            if (c == '*')
+            {
+                min = 0;
+                max = kUnbounded;
+                i++;
+            }
+            else if (c == '+')
+            {
+                min = 1;
+                max = kUnbounded;
+                i++;
+            }
+            else if (c == '?')
+            {
+                min = 0;
+                max = 1;
+                i++;
+            }
+            else if (c == '{')
+            {
+                i++;
+                if (!ParseNumber(min))
+                {
+                    Fail("expected repeat count");
+                    return node;
+                }
+                max = min;
+                if (i < p.size() && p[i] == ',')
+                {
+                    i++;
+                    max = kUnbounded;
+                    if (i < p.size() && p[i] != '}' && !ParseNumber(max))
+                    {
+                        Fail("expected repeat count");
+                        return node;
+                    }
+                }
+                if (i >= p.size() || p[i] != '}')
+                {
+                    Fail("expected '}'");
+                    return node;
+                }
+                i++;
+                if (min > kMaxRepeat || max > kMaxRepeat || (max != kUnbounded && max < min))
+                {
+                    Fail("repeat count out of range");
+                    return node;
+                }
+            }
+            else
+            {
+                break;
+            }
+            node = Add(RegexNode::Kind::Repeat, { node }, -1, min, max);
+        }
+        return node;
+    }
+
+    static ByteSet Range(int lo, int hi)
+    {
+        ByteSet s;
+        for (int c = lo; c <= hi; c++)
+        {
+            s.set(static_cast<size_t>(c));
+        }
+        return s;
+    }
+
+    static ByteSet WordChars()
+    {
+        ByteSet s = Range('a', 'z') | Range('A', 'Z') | Range('0', '9');
+        s.set('_');
+        return s;
+    }
+
+    static ByteSet SpaceChars()
+    {
+        ByteSet s;
+        for (const char c : std::string(" \t\r\n\f\v"))
+        {
+            s.set(static_cast<unsigned char>(c));
+        }
+        return s;
+    }
+
+    // Escape after '\'; class escapes (\s, \w, \d and negations) and single bytes.
+    ByteSet ParseEscape()
+    {
+        if (i >= p.size())
+        {
+            Fail("trailing backslash");
+            return ByteSet();
+        }
+
+        const char c = p[i++];
+        switch (c)
+        {
+            case 's': return SpaceChars();
+            case 'S': return ~SpaceChars();
+            case 'w': return WordChars();
+            case 'W': return ~WordChars();
+            case 'd': return Range('0', '9');
+            case 'D': return ~Range('0', '9');
+            case 'n': return Range('\n', '\n');
+            case 'r': return Range('\r', '\r');
+            case 't': return Range('\t', '\t');
+            case 'b':
+            case 'B':
+            case 'A':
+            case 'z':
+                Fail("assertions are not supported");
+                return ByteSet();
+            default:
+                if (IsIdentChar(static_cast<unsigned char>(c)))
+                {
+                    Fail("unknown escape");
+                    return ByteSet();
+                }
+                return Range(static_cast<unsigned char>(c), static_cast<unsigned char>(c));
+        }
+    }
+
+    ByteSet ParseClass()
+    {
+        ByteSet s;
+        bool negate = false;
+        if (i < p.size() && p[i] == '^')
+        {
+            negate = true;
+            i++;
+        }
+
+        bool first = true;
+        while (error.empty() && i < p.size() && (p[i] != ']' || first))
+        {
+            first = false;
+            ByteSet item;
+            int lo = -1;
+            if (p[i] == '\\')
+            {
+                i++;
+                item = ParseEscape();
+                if (item.count() == 1)
+                {
+                    for (int c = 0; c < 256; c++)
+                    {
+                        if (item[static_cast<size_t>(c)])
+                        {
+                            lo = c;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                lo = static_cast<unsigned char>(p[i++]);
+                item.set(static_cast<size_t>(lo));
+            }
+
+            if (lo >= 0 && i + 1 < p.size() && p[i] == '-' && p[i + 1] != ']')
+            {
+                i++;
+                int hi = static_cast<unsigned char>(p[i]);
+                if (p[i] == '\\')
+                {
+                    i++;
+                    const ByteSet e = ParseEscape();
+                    hi = -1;
+                    for (int c = 0; c < 256; c++)
+                    {
+                        if (e[static_cast<size_t>(c)])
+                        {
+                            hi = (e.count() == 1) ? c : -1;
+                        }
+                    }
+                }
+                else
+                {
+                    i++;
+                }
+                if (hi < lo)
+                {
+                    Fail("invalid class range");
+                    return s;
+                }
+                item = Range(lo, hi);
+            }
+            s |= item;
+        }
+
+        if (i >= p.size())
+        {
+            Fail("expected ']'");
+            return s;
+        }
+        i++;
+        return negate ? ~s : s;
+    }
+
+    int ParseAtom()
+    {
+        const char c = p[i];
+        if (c == '(')
+        {
+            i++;
+            if (p.compare(i, 2, "?:") == 0)
+            {
+                i += 2;
+            }
+            else if (i < p.size() && p[i] == '?')
+            {
+                Fail("unsupported group");
+                return -1;
+            }
+            const int inner = ParseAlt();
+            if (i >= p.size() || p[i] != ')')
+            {
+                Fail("expected ')'");
+                return inner;
+            }
+            i++;
+            return inner;
+        }
+        if (c == '[')
+        {
+            i++;
+            return AddSet(ParseClass());
+        }
+        if (c == '.')
+        {
+            i++;
+            ByteSet s;
+            s.set();
+            s.reset('\n');
+            return AddSet(s);
+        }
+        if (c == '\\')
+        {
+            i++;
+            return AddSet(ParseEscape());
+        }
+        if (c == '*' || c == '+' || c == '?' || c == '{')
+        {
+            Fail("nothing to repeat");
+            return -1;
+        }
+        if (c == '^' || c == '$')
+        {
+            Fail("anchors are not supported");
+            return -1;
+        }
+
+        i++;
+        return AddSet(Range(static_cast<unsigned char>(c), static_cast<unsigned char>(c)));
+    }
+};
+}
+
+// Required-literal analysis: a set of case-folded strings such that every match contains one of them.
+// ' ' never counts as literal, since blanking comments and strings produces spaces the raw bytes lack;
+// that keeps a hit in the raw bytes necessary for a match in the sanitized or literal-only view.
+namespace
+{
+struct LiteralInfo
+{
+    bool exact = false;
+    std::string str;
+    std::vector<std::string> factors;
+};
+
+constexpr size_t kMaxFactors = 16;
+
+static bool ExactByte(const ByteSet& s, char& out)
+{
+    int first = -1;
+    int second = -1;
+    for (int c = 0; c < 256 && second < 0; c++)
+    {
+        if (s[static_cast<size_t>(c)])
+        {
+            (first < 0 ? first : second) = c;
+        }
+    }
+    if (first < 0 || first == ' ' || (second >= 0 && s.count() != 2))
+    {
+        return false;
+    }
+    // Case-folded literals match both cases, which also covers (?i) rules.
+    if (second >= 0 && !(first >= 'A' && first <= 'Z' && second == first - 'A' + 'a'))
+    {
+        return false;
+    }
+    out = static_cast<char>((first >= 'A' && first <= 'Z') ? first - 'A' + 'a' : first);
+    return true;
+}
+
+static size_t FactorScore(const std::vector<std::string>& f)
+{
+    size_t score = static_cast<size_t>(-1);
+    for (const auto& s : f)
+    {
+        score = std::min(score, s.size());
+    }
+    return f.empty() ? 0 : score;
+}
+
+static std::vector<std::string> BestFactors(const LiteralInfo& info)
+{
+    if (info.exact)
+    {
+        return info.str.empty() ? std::vector<std::string>() : std::vector<std::string>{ info.str };
+    }
+    return info.factors;
+}
+
+static LiteralInfo AnalyzeLiterals(const std::vector<RegexNode>& nodes, const std::vector<ByteSet>& sets, int n)
+{
+    const RegexNode& node = nodes[static_cast<size_t>(n)];
+    LiteralInfo info;
+    switch (node.kind)
+    {
+        case RegexNode::Kind::Set:
+        {
+            char c = 0;
+            if (ExactByte(sets[static_cast<size_t>(node.set)], c))
+            {
+                info.exact = true;
+                info.str.assign(1, c);
+            }
+            return info;
+        }
+        case RegexNode::Kind::Empty:
+            info.exact = true;
+            return info;
+        case RegexNode::Kind::Concat:
+        {
+            const auto consider = [&](std::vector<std::string>&& f)
+            {
+                if (FactorScore(f) > FactorScore(info.factors) || (FactorScore(f) == FactorScore(info.factors) && f.size() < info.factors.size()))
+                {
+                    info.factors = std::move(f);
+                }
+            };
+
+            bool all_exact = true;
+            std::string run;
+            for (const int child : node.children)
+            {
+                const LiteralInfo c = AnalyzeLiterals(nodes, sets, child);
+                if (c.exact)
+                {
+                    run += c.str;
+                    continue;
+                }
+                all_exact = false;
+                if (!run.empty())
+                {
+                    consider({ run });
+                    run.clear();
+                }
+                consider(BestFactors(c));
+            }
+            if (all_exact)
+            {
+                info.exact = true;
+                info.str = std::move(run);
+                info.factors.clear();
+            }
+            else if (!run.empty())
+            {
+                consider({ run });
+            }
+            return info;
+        }
+        case RegexNode::Kind::Alt:
+        {
+            for (const int child : node.children)
+            {
+                const std::vector<std::string> f = BestFactors(AnalyzeLiterals(nodes, sets, child));
+                if (f.empty() || info.factors.size() + f.size() > kMaxFactors)
+                {
+                    info.factors.clear();
+                    return info;
+                }
+                info.factors.insert(info.factors.end(), f.begin(), f.end());
+            }
+            std::sort(info.factors.begin(), info.factors.end());
+            info.factors.erase(std::unique(info.factors.begin(), info.factors.end()), info.factors.end());
+            return info;
+        }
+        case RegexNode::Kind::Repeat:
+        default:
+        {
+            if (node.min == 0)
+            {
+                return info;
+            }
+            const LiteralInfo c = AnalyzeLiterals(nodes, sets, node.children[0]);
+            if (c.exact && node.min == node.max)
+            {
+                info.exact = true;
+                for (int k = 0; k < node.min; k++)
+                {
+                    info.str += c.str;
+                }
+                return info;
+            }
+            info.factors = BestFactors(c);
+            return info;
+        }
+    }
+}
+}
+
+// Thompson NFA. Split states carry two epsilon edges (out1 = -1 for a plain epsilon).
+struct RegexNfa
+{
+    enum class Kind : uint8_t
+    {
+        Set,
+        Split,
+        Match
+    };
+
+    struct State
+    {
+        Kind kind;
+        int set;
+        int out;
+        int out1;
+        int rule;
+    };
+
+    std::vector<State> states;
+    std::vector<ByteSet> sets;
+    std::vector<int> starts;
+
+    struct Frag
+    {
+        int start;
+        std::vector<std::pair<int, int>> outs;
+    };
+
+    int NewState(Kind kind, int set, int out, int out1, int rule)
+    {
+        states.push_back({ kind, set, out, out1, rule });
+        return static_cast<int>(states.size() - 1);
+    }
+
+    void Patch(const std::vector<std::pair<int, int>>& outs, int target)
+    {
+        for (const auto& o : outs)
+        {
+            (o.second == 0 ? states[o.first].out : states[o.first].out1) = target;
+        }
+    }
+
+    Frag Build(const std::vector<RegexNode>& nodes, int n, bool reversed)
+    {
+        const RegexNode& node = nodes[n];
+        switch (node.kind)
+        {
+            case RegexNode::Kind::Set:
+            {
+                const int s = NewState(Kind::Set, node.set, -1, -1, -1);
+                return { s, { { s, 0 } } };
+            }
+            case RegexNode::Kind::Empty:
+            {
+                const int s = NewState(Kind::Split, -1, -1, -1, -1);
+                return { s, { { s, 0 } } };
+            }
+            case RegexNode::Kind::Concat:
+            {
+                std::vector<int> order = node.children;
+                if (reversed)
+                {
+                    std::reverse(order.begin(), order.end());
+                }
+                Frag f = Build(nodes, order[0], reversed);
+                for (size_t k = 1; k < order.size(); k++)
+                {
+                    Frag next = Build(nodes, order[k], reversed);
+                    Patch(f.outs, next.start);
+                    f.outs = std::move(next.outs);
+                }
+                return f;
+            }
+            case RegexNode::Kind::Alt:
+            {
+                Frag f = Build(nodes, node.children[0], reversed);
+                for (size_t k = 1; k < node.children.size(); k++)
+                {
+                    Frag other = Build(nodes, node.children[k], reversed);
+                    const int s = NewState(Kind::Split, -1, f.start, other.start, -1);
+                    f.start = s;
+                    f.outs.insert(f.outs.end(), other.outs.begin(), other.outs.end());
+                }
+                return f;
+            }
+            case RegexNode::Kind::Repeat:
+            default:
+            {
+                // x{m,n} = x repeated m times, then (n - m) optional copies, or x* when unbounded.
+                Frag f = { NewState(Kind::Split, -1, -1, -1, -1), {} };
+                f.outs.push_back({ f.start, 0 });
+                for (int k = 0; k < node.min; k++)
+                {
+                    Frag next = Build(nodes, node.children[0], reversed);
+                    Patch(f.outs, next.start);
+                    f.outs = std::move(next.outs);
+                }
+                if (node.max == kUnbounded)
+                {
+                    Frag body = Build(nodes, node.children[0], reversed);
+                    const int loop = NewState(Kind::Split, -1, body.start, -1, -1);
+                    Patch(body.outs, loop);
+                    Patch(f.outs, loop);
+                    f.outs = { { loop, 1 } };
+                }
+                else
+                {
+                    std::vector<std::pair<int, int>> skips;
+                    for (int k = node.min; k < node.max; k++)
+                    {
+                        Frag body = Build(nodes, node.children[0], reversed);
+                        const int opt = NewState(Kind::Split, -1, body.start, -1, -1);
+                        Patch(f.outs, opt);
+                        skips.push_back({ opt, 1 });
+                        f.outs = std::move(body.outs);
+                    }
+                    f.outs.insert(f.outs.end(), skips.begin(), skips.end());
+                }
+                return f;
+            }
+        }
+    }
+
+    void AddRule(const std::vector<RegexNode>& nodes, int root, int rule, bool reversed)
+    {
+        Frag f = Build(nodes, root, reversed);
+        const int m = NewState(Kind::Match, -1, -1, -1, rule);
+        Patch(f.outs, m);
+        starts.push_back(f.start);
+    }
+
+    // Adds the epsilon closure of s to out, keeping only Set and Match states.
+    void Closure(int s, std::vector<uint32_t>& mark, uint32_t gen, std::vector<int>& out, std::vector<int>& stack) const
+    {
+        stack.push_back(s);
+        while (!stack.empty())
+        {
+            const int t = stack.back();
+            stack.pop_back();
+            if (t < 0 || mark[static_cast<size_t>(t)] == gen)
+            {
+                continue;
+            }
+            mark[static_cast<size_t>(t)] = gen;
+
+            const State& st = states[static_cast<size_t>(t)];
+            if (st.kind == Kind::Split)
+            {
+                stack.push_back(st.out1);
+                stack.push_back(st.out);
+            }
+            else
+            {
+                out.push_back(t);
+            }
+        }
+    }
+};
+
+struct RegexDfa
+{
+    size_t classes = 0;
+    uint8_t byte_class[256] = {};
+    // Entry = (target * classes << 1) | target_is_accepting; row offsets are pre-multiplied for the hot loop.
+    std::vector<uint32_t> next;
+    std::vector<uint32_t> accept_begin;
+    std::vector<uint16_t> accept_rules;
+    uint32_t start = 0;
+    std::vector<uint16_t> rules;
+};
+
+// Splits the byte alphabet into classes no set distinguishes, which shrinks every DFA row.
+static size_t ComputeByteClasses(const std::vector<ByteSet>& sets, uint8_t (&byte_class)[256])
+{
+    std::vector<uint32_t> cls(256, 0);
+    size_t count = 1;
+    for (const auto& s : sets)
+    {
+        std::unordered_map<uint64_t, uint32_t> remap;
+        for (size_t b = 0; b < 256; b++)
+        {
+            const uint64_t key = (static_cast<uint64_t>(cls[b]) << 1) | (s[b] ? 1u : 0u);
+            const auto it = remap.emplace(key, static_cast<uint32_t>(remap.size())).first;
+            cls[b] = it->second;
+        }
+        count = remap.size();
+    }
+    for (size_t b = 0; b < 256; b++)
+    {
+        byte_class[b] = static_cast<uint8_t>(cls[b]);
+    }
+    return count;
+}
+
+static std::string SetKey(const std::vector<int>& states)
+{
+    return std::string(reinterpret_cast<const char*>(states.data()), states.size() * sizeof(int));
+}
+
+// Subset construction for an unanchored search: every state also contains the closure of all rule starts.
+// That closure is left implicit in the subsets, so keys stay small and its moves are computed once per class.
+static bool BuildDfa(const RegexNfa& nfa, const std::vector<int>& starts, RegexDfa& dfa, std::string& err)
+{
+    dfa.classes = ComputeByteClasses(nfa.sets, dfa.byte_class);
+
+    uint8_t representative[256] = {};
+    for (int b = 255; b >= 0; b--)
+    {
+        representative[dfa.byte_class[b]] = static_cast<uint8_t>(b);
+    }
+
+    std::vector<uint32_t> mark(nfa.states.size(), 0);
+    uint32_t gen = 0;
+    std::vector<int> stack;
+
+    std::vector<int> start_set;
+    gen++;
+    for (const int s : starts)
+    {
+        nfa.Closure(s, mark, gen, start_set, stack);
+    }
+    std::vector<char> in_start(nfa.states.size(), 0);
+    for (const int s : start_set)
+    {
+        in_start[static_cast<size_t>(s)] = 1;
+    }
+
+    std::vector<int> moved;
+    const auto step = [&](const std::vector<int>& from, size_t b)
+    {
+        for (const int s : from)
+        {
+            const RegexNfa::State& st = nfa.states[static_cast<size_t>(s)];
+            if (st.kind == RegexNfa::Kind::Set && nfa.sets[static_cast<size_t>(st.set)][b])
+            {
+                nfa.Closure(st.out, mark, gen, moved, stack);
+            }
+        }
+    };
+
+    std::vector<std::vector<int>> start_moves(dfa.classes);
+    for (size_t c = 0; c < dfa.classes; c++)
+    {
+        moved.clear();
+        gen++;
+        step(start_set, representative[c]);
+        for (const int s : moved)
+        {
+            if (!in_start[static_cast<size_t>(s)])
+            {
+                start_moves[c].push_back(s);
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> subsets;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<char> accepting;
+
+    const auto intern = [&](std::vector<int>&& set) -> uint32_t
+    {
+        const auto it = ids.find(SetKey(set));
+        if (it != ids.end())
+        {
+            return it->second;
+        }
+
+        const uint32_t id = static_cast<uint32_t>(subsets.size());
+        ids.emplace(SetKey(set), id);
+
+        dfa.accept_begin.push_back(static_cast<uint32_t>(dfa.accept_rules.size()));
+        for (const int s : set)
+        {
+            if (nfa.states[static_cast<size_t>(s)].kind == RegexNfa::Kind::Match)
+            {
+                dfa.accept_rules.push_back(static_cast<uint16_t>(nfa.states[static_cast<size_t>(s)].rule));
+            }
+        }
+        accepting.push_back(dfa.accept_rules.size() > dfa.accept_begin.back() ? 1 : 0);
+        subsets.push_back(std::move(set));
+        return id;
+    };
+
+    dfa.start = intern(std::vector<int>());
+
+    for (size_t d = 0; d < subsets.size(); d++)
+    {
+        if (subsets.size() > RegexRuleSet::kMaxDfaStates)
+        {
+            err = "regex rules need more than " + std::to_string(RegexRuleSet::kMaxDfaStates) + " DFA states";
+            return false;
+        }
+
+        dfa.next.resize((d + 1) * dfa.classes);
+        for (size_t c = 0; c < dfa.classes; c++)
+        {
+            moved.clear();
+            gen++;
+            step(subsets[d], representative[c]);
+            for (const int s : start_moves[c])
+            {
+                if (mark[static_cast<size_t>(s)] != gen)
+                {
+                    mark[static_cast<size_t>(s)] = gen;
+                    moved.push_back(s);
+                }
+            }
+            moved.erase(std::remove_if(moved.begin(), moved.end(), [&](int s) { return in_start[static_cast<size_t>(s)] != 0; }), moved.end());
+            std::sort(moved.begin(), moved.end());
+
+            const uint32_t target = intern(std::vector<int>(moved));
+            dfa.next[d * dfa.classes + c] = ((target * static_cast<uint32_t>(dfa.classes)) << 1) | static_cast<uint32_t>(accepting[target]);
+        }
+    }
+
+    dfa.accept_begin.push_back(static_cast<uint32_t>(dfa.accept_rules.size()));
+    return true;
+}
+
+// Rules whose tails overlap other rules' prefixes multiply states, so a set that does not fit one
+// table is split in halves until every part does; each part costs one more pass over the text.
+static bool BuildDfaGroups(const RegexNfa& nfa, const std::vector<uint16_t>& rules, std::vector<RegexDfa>& out, std::string& err)
+{
+    if (rules.empty())
+    {
+        return true;
+    }
+
+    std::vector<int> starts;
+    for (const uint16_t r : rules)
+    {
+        starts.push_back(nfa.starts[r]);
+    }
+
+    RegexDfa dfa;
+    if (BuildDfa(nfa, starts, dfa, err))
+    {
+        dfa.rules = rules;
+        out.push_back(std::move(dfa));
+        return true;
+    }
+    if (rules.size() == 1)
+    {
+        return false;
+    }
+
+    const auto mid = rules.begin() + static_cast<std::ptrdiff_t>(rules.size() / 2);
+    return BuildDfaGroups(nfa, std::vector<uint16_t>(rules.begin(), mid), out, err)
+        && BuildDfaGroups(nfa, std::vector<uint16_t>(mid, rules.end()), out, err);
+}
+
+// One NFA over the required literals of all gated rules, each literal matching in either letter case.
+static void AddTriggerLiterals(RegexNfa& nfa, const std::vector<std::string>& literals, int rule)
+{
+    for (const auto& lit : literals)
+    {
+        std::vector<RegexNode> nodes;
+        std::vector<int> children;
+        for (const char ch : lit)
+        {
+            const unsigned char c = static_cast<unsigned char>(ch);
+            ByteSet set;
+            set.set(c);
+            if (c >= 'a' && c <= 'z')
+            {
+                set.set(static_cast<size_t>(c - 'a' + 'A'));
+            }
+            nodes.push_back({ RegexNode::Kind::Set, static_cast<int>(nfa.sets.size()), {}, 0, 0 });
+            nfa.sets.push_back(set);
+            children.push_back(static_cast<int>(nodes.size() - 1));
+        }
+        nodes.push_back({ RegexNode::Kind::Concat, -1, std::move(children), 0, 0 });
+        nfa.AddRule(nodes, static_cast<int>(nodes.size() - 1), rule, false);
+    }
+}
+
+RegexRuleSet::RegexRuleSet() = default;
+RegexRuleSet::~RegexRuleSet() = default;
+
+static bool ParseRuleSeverity(const std::string& s, Severity& out)
+{
+    if (s == "low")
+    {
+        out = Severity::Low;
+        return true;
+    }
+    if (s == "med" || s == "medium")
+    {
+        out = Severity::Medium;
+        return true;
+    }
+    if (s == "high")
+    {
+        out = Severity::High;
+        return true;
+    }
+    return false;
+}
+
+bool RegexRuleSet::LoadFile(const std::filesystem::path& p, std::vector<RegexRule>& out, std::string& err)
+{
+    err.clear();
+
+    std::string data;
+    if (!ReadFileAll(p, data, err))
+    {
+        err = "failed to open rule file";
+        return false;
+    }
+
+    std::istringstream in(data);
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line))
+    {
+        line_no++;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        std::istringstream fields(line);
+        RegexRule r;
+        std::string severity;
+        std::string target;
+        if (!(fields >> r.rule_id) || r.rule_id[0] == '#')
+        {
+            continue;
+        }
+
+        fields >> severity >> target;
+        std::getline(fields, r.pattern);
+        r.pattern = Trim(r.pattern);
+
+        if (!ParseRuleSeverity(severity, r.severity) || (target != "code" && target != "text") || r.pattern.empty())
+        {
+            err = "invalid rule at line " + std::to_string(line_no);
+            return false;
+        }
+        r.target = (target == "code") ? RegexTarget::Code : RegexTarget::Text;
+        out.push_back(std::move(r));
+    }
+    return true;
+}
+
+bool RegexRuleSet::Compile(const std::vector<RegexRule>& input, std::string& err)
+{
+    err.clear();
+    rules = input;
+    reverse.clear();
+    code.clear();
+    text.clear();
+    trigger.clear();
+    gated.assign(rules.size(), 0);
+
+    if (rules.size() > 0xffff)
+    {
+        err = "too many regex rules";
+        return false;
+    }
+
+    RegexNfa forward;
+    RegexNfa literals;
+    std::vector<uint16_t> code_rules;
+    std::vector<uint16_t> text_rules;
+
+    for (size_t r = 0; r < rules.size(); r++)
+    {
+        std::vector<RegexNode> nodes;
+        std::vector<ByteSet> sets;
+        PatternParser parser(rules[r].pattern, nodes, sets);
+        const int root = parser.Parse(err);
+        if (root < 0)
+        {
+            err = rules[r].rule_id + ": " + err;
+            return false;
+        }
+
+        // Each rule's sets are appended to the shared forward NFA, so shift its set indices.
+        const int base = static_cast<int>(forward.sets.size());
+        forward.sets.insert(forward.sets.end(), sets.begin(), sets.end());
+        std::vector<RegexNode> shifted = nodes;
+        for (auto& n : shifted)
+        {
+            if (n.kind == RegexNode::Kind::Set)
+            {
+                n.set += base;
+            }
+        }
+        forward.AddRule(shifted, root, static_cast<int>(r), false);
+
+        std::vector<uint32_t> mark(forward.states.size(), 0);
+        std::vector<int> closure;
+        std::vector<int> stack;
+        forward.Closure(forward.starts.back(), mark, 1, closure, stack);
+        for (const int s : closure)
+        {
+            if (forward.states[static_cast<size_t>(s)].kind == RegexNfa::Kind::Match)
+            {
+                err = rules[r].rule_id + ": pattern matches the empty string";
+                return false;
+            }
+        }
+        (rules[r].target == RegexTarget::Code ? code_rules : text_rules).push_back(static_cast<uint16_t>(r));
+
+        const std::vector<std::string> required = BestFactors(AnalyzeLiterals(nodes, sets, root));
+        if (!required.empty())
+        {
+            AddTriggerLiterals(literals, required, static_cast<int>(r));
+            gated[r] = 1;
+        }
+
+        RegexNfa rev;
+        rev.sets = std::move(sets);
+        rev.AddRule(nodes, root, static_cast<int>(r), true);
+        reverse.push_back(std::move(rev));
+    }
+
+    if (!BuildDfaGroups(forward, code_rules, code, err) || !BuildDfaGroups(forward, text_rules, text, err))
+    {
+        return false;
+    }
+
+    // Literal gating is only a shortcut: if the literals do not fit one table, every rule runs ungated.
+    if (!literals.starts.empty())
+    {
+        RegexDfa dfa;
+        std::string trigger_err;
+        if (BuildDfa(literals, literals.starts, dfa, trigger_err))
+        {
+            trigger.push_back(std::move(dfa));
+        }
+        else
+        {
+            gated.assign(rules.size(), 0);
+        }
+    }
+    return true;
+}
+
+size_t RegexRuleSet::Size() const
+{
+    return rules.size();
+}
+
+const RegexRule& RegexRuleSet::Rule(size_t i) const
+{
+    return rules[i];
+}
+
+bool RegexRuleSet::FindCandidates(std::string_view raw, std::vector<char>& candidates) const
+{
+    candidates.assign(rules.size(), 0);
+    size_t pending = 0;
+    for (size_t r = 0; r < rules.size(); r++)
+    {
+        candidates[r] = gated[r] ? 0 : 1;
+        pending += gated[r] ? 1 : 0;
+    }
+
+    if (pending != 0)
+    {
+        const RegexDfa& dfa = trigger[0];
+        const uint32_t* next = dfa.next.data();
+        const auto* p = reinterpret_cast<const unsigned char*>(raw.data());
+        size_t row = dfa.start * dfa.classes;
+        for (size_t i = 0; i < raw.size() && pending != 0; i++)
+        {
+            const uint32_t t = next[row + dfa.byte_class[p[i]]];
+            row = t >> 1;
+            if (t & 1u)
+            {
+                const size_t state = row / dfa.classes;
+                for (uint32_t a = dfa.accept_begin[state]; a < dfa.accept_begin[state + 1]; a++)
+                {
+                    if (!candidates[dfa.accept_rules[a]])
+                    {
+                        candidates[dfa.accept_rules[a]] = 1;
+                        pending--;
+                    }
+                }
+            }
+        }
+    }
+
+    return std::find(candidates.begin(), candidates.end(), 1) != candidates.end();
+}
+
+static bool HoldsCandidate(const RegexDfa& dfa, const std::vector<char>& candidates)
+{
+    return std::any_of(dfa.rules.begin(), dfa.rules.end(), [&](uint16_t r) { return candidates[r] != 0; });
+}
+
+bool RegexRuleSet::HasTarget(RegexTarget target, const std::vector<char>& candidates) const
+{
+    const std::vector<RegexDfa>& dfas = (target == RegexTarget::Code) ? code : text;
+    return std::any_of(dfas.begin(), dfas.end(), [&](const RegexDfa& dfa) { return HoldsCandidate(dfa, candidates); });
+}
+
+size_t RegexRuleSet::DfaStates(RegexTarget target) const
+{
+    size_t states = 0;
+    for (const auto& dfa : (target == RegexTarget::Code) ? code : text)
+    {
+        states += dfa.accept_begin.size() - 1;
+    }
+    return states;
+}
+
+size_t RegexRuleSet::DfaCount(RegexTarget target) const
+{
+    return ((target == RegexTarget::Code) ? code : text).size();
+}
+
+// Runs the rule's reversed NFA backwards from end; the last position where it accepts is the leftmost start.
+static size_t LeftmostStart(const RegexNfa& rev, std::string_view text, size_t end)
+{
+    const size_t kMaxBack = 64 * 1024;
+    const size_t limit = (end > kMaxBack) ? end - kMaxBack : 0;
+
+    std::vector<uint32_t> mark(rev.states.size(), 0);
+    uint32_t gen = 1;
+    std::vector<int> stack;
+    std::vector<int> cur;
+    std::vector<int> next;
+    rev.Closure(rev.starts[0], mark, gen, cur, stack);
+
+    size_t start = end;
+    for (size_t pos = end; pos > limit && !cur.empty(); pos--)
+    {
+        const size_t b = static_cast<unsigned char>(text[pos - 1]);
+        next.clear();
+        gen++;
+        for (const int s : cur)
+        {
+            const RegexNfa::State& st = rev.states[static_cast<size_t>(s)];
+            if (st.kind == RegexNfa::Kind::Set && rev.sets[static_cast<size_t>(st.set)][b])
+            {
+                rev.Closure(st.out, mark, gen, next, stack);
+            }
+        }
+        for (const int s : next)
+        {
+            if (rev.states[static_cast<size_t>(s)].kind == RegexNfa::Kind::Match)
+            {
+                start = pos - 1;
+                break;
+            }
+        }
+        cur.swap(next);
+    }
+    return start;
+}
+
+void RegexRuleSet::Match(RegexTarget target, std::string_view input, const std::vector<char>& candidates, const RegexMatchCallback& on_match) const
+{
+    std::vector<const RegexDfa*> dfas;
+    for (const auto& dfa : (target == RegexTarget::Code) ? code : text)
+    {
+        if (HoldsCandidate(dfa, candidates))
+        {
+            dfas.push_back(&dfa);
+        }
+    }
+    if (dfas.empty())
+    {
+        return;
+    }
+
+    std::vector<size_t> reported_line(rules.size(), static_cast<size_t>(-1));
+    size_t line_start = 0;
+    const auto report = [&](const RegexDfa& dfa, size_t row, size_t end)
+    {
+        const size_t state = row / dfa.classes;
+        for (uint32_t a = dfa.accept_begin[state]; a < dfa.accept_begin[state + 1]; a++)
+        {
+            const size_t rule = dfa.accept_rules[a];
+            if (reported_line[rule] != line_start)
+            {
+                reported_line[rule] = line_start;
+                on_match(rule, LeftmostStart(reverse[rule], input, end), end);
+            }
+        }
+    };
+
+    const auto* p = reinterpret_cast<const unsigned char*>(input.data());
+    const size_t n = input.size();
+
+    // Table walks are latency bound, so split rule sets advance together over the same bytes.
+    size_t first = 0;
+    for (; first + 1 < dfas.size(); first += 2)
+    {
+        const RegexDfa& a = *dfas[first];
+        const RegexDfa& b = *dfas[first + 1];
+        const uint32_t* next_a = a.next.data();
+        const uint32_t* next_b = b.next.data();
+        size_t row_a = a.start * a.classes;
+        size_t row_b = b.start * b.classes;
+        line_start = 0;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            const uint32_t ta = next_a[row_a + a.byte_class[p[i]]];
+            const uint32_t tb = next_b[row_b + b.byte_class[p[i]]];
+            row_a = ta >> 1;
+            row_b = tb >> 1;
+
+            if ((ta | tb) & 1u)
+            {
+                if (ta & 1u)
+                {
+                    report(a, row_a, i + 1);
+                }
+                if (tb & 1u)
+                {
+                    report(b, row_b, i + 1);
+                }
+            }
+
+            if (p[i] == '\n')
+            {
+                line_start = i + 1;
+            }
+        }
+    }
+
+    if (first < dfas.size())
+    {
+        const RegexDfa& a = *dfas[first];
+        const uint32_t* next = a.next.data();
+        size_t row = a.start * a.classes;
+        line_start = 0;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            const uint32_t t = next[row + a.byte_class[p[i]]];
+            row = t >> 1;
+            if (t & 1u)
+            {
+                report(a, row, i + 1);
+            }
+            if (p[i] == '\n')
+            {
+                line_start = i + 1;
+            }
+        }
+    }
+}
+}
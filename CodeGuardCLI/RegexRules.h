@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Scanner.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+namespace codeguard
+{
+enum class RegexTarget
+{
+    Code,
+    Text
+};
+
+struct RegexRule
+{
+    std::string rule_id;
+    Severity severity;
+    RegexTarget target;
+    std::string pattern;
+};
+
+struct RegexNfa;
+struct RegexDfa;
+
+using RegexMatchCallback = std::function<void(size_t rule, size_t start, size_t end)>;
+
+// User-defined regex rules. All rules of one target are compiled at startup into a combined DFA over
+// byte classes, so a buffer is matched with one table lookup per byte and no backtracking. A rule set
+// too large for one table of kMaxDfaStates is split over a few DFAs, one pass each. Literals every match
+// of a rule must contain are searched first, so files without them skip the rule's DFA entirely.
+// Supported syntax: literals, '.', [...] classes, \s \S \w \W \d \D, groups ((...), (?:...)), '|',
+// '*', '+', '?', {m}, {m,}, {m,n}, and a leading (?i) for case-insensitive rules.
+class RegexRuleSet final
+{
+public:
+    RegexRuleSet();
+    ~RegexRuleSet();
+
+    RegexRuleSet(const RegexRuleSet&) = delete;
+    RegexRuleSet& operator=(const RegexRuleSet&) = delete;
+
+    // One rule per line: "<id> <low|med|high> <code|text> <pattern>"; blank lines and '#' comments are skipped.
+    static bool LoadFile(const std::filesystem::path& p, std::vector<RegexRule>& rules, std::string& err);
+
+    bool Compile(const std::vector<RegexRule>& rules, std::string& err);
+
+    size_t Size() const;
+    const RegexRule& Rule(size_t i) const;
+    // Marks the rules whose required literals occur in raw; rules without required literals are always
+    // marked. An unmarked rule cannot match raw, nor its sanitized or literal-only view.
+    bool FindCandidates(std::string_view raw, std::vector<char>& candidates) const;
+
+    bool HasTarget(RegexTarget target, const std::vector<char>& candidates) const;
+    size_t DfaStates(RegexTarget target) const;
+    size_t DfaCount(RegexTarget target) const;
+
+    // Reports at most one match per rule and line: the one that ends first, with its leftmost start.
+    // DFAs that hold no candidate rule are skipped.
+    void Match(RegexTarget target, std::string_view text, const std::vector<char>& candidates, const RegexMatchCallback& on_match) const;
+
+    static constexpr size_t kMaxDfaStates = 32768;
+
+private:
+    std::vector<RegexRule> rules;
+    std::vector<RegexNfa> reverse;
+    std::vector<RegexDfa> code;
+    std::vector<RegexDfa> text;
+    std::vector<RegexDfa> trigger;
+    std::vector<char> gated;
+};
+}
@@ -0,0 +1,289 @@
+#include "Results.h"
+
+#include "Util.h"
+#include "Baseline.h"
+
+#include <algorithm>
+
+namespace codeguard
+{
+static const char kResultMagic[4] = { 'C', 'G', 'R', 'S' };
+static const uint32_t kResultVersion = 1;
+
+static void AppendString(std::string& out, const std::string& s, int len_bytes)
+{
+    const size_t maxLen = (len_bytes == 1) ? 0xff : 0xffff;
+    const size_t n = std::min(s.size(), maxLen);
+    for (int i = 0; i < len_bytes; i++)
+    {
+        out.push_back(static_cast<char>((n >> (8 * i)) & 0xff));
+    }
+    out.append(s, 0, n);
+}
+
+bool WriteResultFile(const std::filesystem::path& p, const ScanResult& result, const std::filesystem::path& root, std::string& err)
+{
+    err.clear();
+
+    std::vector<std::pair<uint64_t, const Finding*>> order;
+    order.reserve(result.findings.size());
+    for (const auto& f : result.findings)
+    {
+        order.emplace_back(FindingFingerprint(f, root), &f);
+    }
+    std::sort(order.begin(), order.end(), [](const auto& a, const auto& b)
+    {
+        if (a.first != b.first)
+        {
+            return a.first < b.first;
+        }
+        return a.second->line < b.second->line;
+    });
+
+    std::ofstream f(p, std::ios::binary | std::ios::trunc);
+    if (!f)
+    {
+        err = "failed to create result file";
+        return false;
+    }
+
+    std::string out;
+    out.reserve(1 << 20);
+    out.append(kResultMagic, 4);
+    AppendU32(out, kResultVersion);
+    AppendU64(out, static_cast<uint64_t>(order.size()));
+
+    for (const auto& o : order)
+    {
+        const Finding& fd = *o.second;
+        std::filesystem::path rel = fd.file_path.lexically_relative(root);
+        if (rel.empty())
+        {
+            rel = fd.file_path;
+        }
+
+        std::string path = PathToUtf8(rel);
+        std::replace(path.begin(), path.end(), '\\', '/');
+
+        AppendU64(out, o.first);
+        AppendU32(out, static_cast<uint32_t>(fd.line));
+        AppendU32(out, static_cast<uint32_t>(fd.column));
+        out.push_back(static_cast<char>(fd.severity));
+        AppendString(out, fd.rule_id, 1);
+        AppendString(out, path, 2);
+        AppendString(out, fd.message, 2);
+        AppendString(out, fd.line_text, 2);
+
+        if (out.size() >= (1 << 20))
+        {
+            f.write(out.data(), static_cast<std::streamsize>(out.size()));
+            out.clear();
+        }
+    }
+
+    f.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!f)
+    {
+        err = "failed to write result file";
+        return false;
+    }
+    return true;
+}
+
+ResultReader::ResultReader()
+{
+    buffer.resize(1 << 20);
+    count = 0;
+    read = 0;
+    failed = false;
+}
+
+bool ResultReader::Open(const std::filesystem::path& p, std::string& err)
+{
+    err.clear();
+    in.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    in.open(p, std::ios::binary);
+    if (!in)
+    {
+        err = "failed to open result file";
+        return false;
+    }
+
+    unsigned char header[16];
+    if (!ReadBytes(header, sizeof(header)) || !std::equal(kResultMagic, kResultMagic + 4, reinterpret_cast<const char*>(header)))
+    {
+        err = "not a result file";
+        return false;
+    }
+    if (LoadLE(header + 4, 4) != kResultVersion)
+    {
+        err = "unsupported result file version";
+        return false;
+    }
+
+    count = LoadLE(header + 8, 8);
+    read = 0;
+    return true;
+}
+
+bool ResultReader::ReadBytes(void* dst, size_t n)
+{
+    in.read(static_cast<char*>(dst), static_cast<std::streamsize>(n));
+    if (!in)
+    {
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool ResultReader::ReadString(std::string& s, int len_bytes)
+{
+    unsigned char len[2] = { 0, 0 };
+    if (!ReadBytes(len, static_cast<size_t>(len_bytes)))
+    {
+        return false;
+    }
+    s.resize(static_cast<size_t>(LoadLE(len, len_bytes)));
+    return s.empty() || ReadBytes(s.data(), s.size());
+}
+
+bool ResultReader::Next(ResultRecord& r)
+{
+    if (read >= count || failed)
+    {
+        return false;
+    }
+
+    unsigned char fixed[17];
+    if (!ReadBytes(fixed, sizeof(fixed)))
+    {
+        return false;
+    }
+    r.fingerprint = LoadLE(fixed, 8);
+    r.line = static_cast<uint32_t>(LoadLE(fixed + 8, 4));
+    r.column = static_cast<uint32_t>(LoadLE(fixed + 12, 4));
+    r.severity = static_cast<Severity>(fixed[16]);
+
+    if (!ReadString(r.rule_id, 1) || !ReadString(r.path, 2) || !ReadString(r.message, 2) || !ReadString(r.line_text, 2))
+    {
+        return false;
+    }
+
+    read++;
+    return true;
+}
+
+uint64_t ResultReader::Count() const
+{
+    return count;
+}
+
+bool ResultReader::Failed() const
+{
+    return failed;
+}
+
+// Pulls every record with the current fingerprint; groups are tiny, so memory stays bounded.
+static void ReadGroup(ResultReader& reader, ResultRecord& lookahead, bool& has_lookahead, std::vector<ResultRecord>& group)
+{
+    group.clear();
+    if (!has_lookahead)
+    {
+        return;
+    }
+
+    const uint64_t fp = lookahead.fingerprint;
+    group.push_back(std::move(lookahead));
+    has_lookahead = false;
+
+    ResultRecord r;
+    while (reader.Next(r))
+    {
+        if (r.fingerprint != fp)
+        {
+            lookahead = std::move(r);
+            has_lookahead = true;
+            return;
+        }
+        group.push_back(std::move(r));
+    }
+}
+
+bool DiffResultFiles(
+    const std::filesystem::path& old_path,
+    const std::filesystem::path& new_path,
+    const DiffCallback& on_change,
+    DiffSummary& summary,
+    std::string& err
+)
+{
+    summary = { 0, 0, 0, 0 };
+
+    ResultReader a;
+    ResultReader b;
+    if (!a.Open(old_path, err) || !b.Open(new_path, err))
+    {
+        return false;
+    }
+
+    ResultRecord la;
+    ResultRecord lb;
+    bool hasA = a.Next(la);
+    bool hasB = b.Next(lb);
+
+    std::vector<ResultRecord> ga;
+    std::vector<ResultRecord> gb;
+
+    while (hasA || hasB)
+    {
+        if (hasA && (!hasB || la.fingerprint < lb.fingerprint))
+        {
+            ReadGroup(a, la, hasA, ga);
+            gb.clear();
+        }
+        else if (hasB && (!hasA || lb.fingerprint < la.fingerprint))
+        {
+            ga.clear();
+            ReadGroup(b, lb, hasB, gb);
+        }
+        else
+        {
+            ReadGroup(a, la, hasA, ga);
+            ReadGroup(b, lb, hasB, gb);
+        }
+
+        const size_t paired = std::min(ga.size(), gb.size());
+        for (size_t i = 0; i < paired; i++)
+        {
+            if (ga[i].line != gb[i].line)
+            {
+                summary.moved++;
+                on_change(DiffKind::Moved, &ga[i], &gb[i]);
+            }
+            else
+            {
+                summary.unchanged++;
+                on_change(DiffKind::Unchanged, &ga[i], &gb[i]);
+            }
+        }
+        for (size_t i = paired; i < ga.size(); i++)
+        {
+            summary.fixed++;
+            on_change(DiffKind::Fixed, &ga[i], nullptr);
+        }
+        for (size_t i = paired; i < gb.size(); i++)
+        {
+            summary.introduced++;
+            on_change(DiffKind::Introduced, nullptr, &gb[i]);
+        }
+    }
+
+    if (a.Failed() || b.Failed())
+    {
+        err = "truncated result file";
+        return false;
+    }
+    return true;
+}
+}
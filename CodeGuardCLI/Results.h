@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Scanner.h"
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+namespace codeguard
+{
+struct ResultRecord
+{
+    uint64_t fingerprint;
+    uint32_t line;
+    uint32_t column;
+    Severity severity;
+    std::string rule_id;
+    std::string path;
+    std::string message;
+    std::string line_text;
+};
+
+// Records are stored sorted by fingerprint so two files can be diffed with a streaming merge.
+bool WriteResultFile(const std::filesystem::path& p, const ScanResult& result, const std::filesystem::path& root, std::string& err);
+
+class ResultReader final
+{
+public:
+    ResultReader();
+
+    bool Open(const std::filesystem::path& p, std::string& err);
+    bool Next(ResultRecord& r);
+    uint64_t Count() const;
+    bool Failed() const;
+
+private:
+    std::ifstream in;
+    std::vector<char> buffer;
+    uint64_t count;
+    uint64_t read;
+    bool failed;
+
+    bool ReadBytes(void* dst, size_t n);
+    bool ReadString(std::string& s, int len_bytes);
+};
+
+enum class DiffKind
+{
+    Introduced,
+    Fixed,
+    Moved,
+    Unchanged
+};
+
+struct DiffSummary
+{
+    uint64_t introduced;
+    uint64_t fixed;
+    uint64_t moved;
+    uint64_t unchanged;
+};
+
+// old_record is null for Introduced, new_record is null for Fixed.
+using DiffCallback = std::function<void(DiffKind kind, const ResultRecord* old_record, const ResultRecord* new_record)>;
+
+bool DiffResultFiles(
+    const std::filesystem::path& old_path,
+    const std::filesystem::path& new_path,
+    const DiffCallback& on_change,
+    DiffSummary& summary,
+    std::string& err
+);
+}
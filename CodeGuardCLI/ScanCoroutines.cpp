@@ -0,0 +1,90 @@
+#include "ScanCoroutines.h"
+
+#include <system_error>
+
+namespace codeguard
+{
+void QueueExecutor::Post(std::coroutine_handle<> h)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(h);
+}
+
+bool QueueExecutor::RunOne()
+{
+    std::coroutine_handle<> h;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty())
+        {
+            return false;
+        }
+        h = queue.front();
+        queue.pop_front();
+    }
+    h.resume();
+    return true;
+}
+
+size_t QueueExecutor::RunPending()
+{
+    size_t n = 0;
+    while (RunOne())
+    {
+        n++;
+    }
+    return n;
+}
+
+Generator<Finding> ScanFindings(const Scanner& scanner, std::filesystem::path root, CancellationToken token)
+{
+    std::error_code ec;
+    std::filesystem::recursive_directory_iterator it(
+        root,
+        std::filesystem::directory_options::skip_permission_denied,
+        ec
+    );
+
+    const auto end = std::filesystem::recursive_directory_iterator();
+
+    for (; it != end; it.increment(ec))
+    {
+        if (ec)
+        {
+            ec.clear();
+            continue;
+        }
+        if (token.IsCancelled())
+        {
+            co_return;
+        }
+
+        const auto& entry = *it;
+        if (!entry.is_regular_file(ec) || !scanner.IsCandidate(entry.path()))
+        {
+            continue;
+        }
+
+        const ScanResult r = scanner.ScanSingleFile(entry.path());
+        for (const auto& f : r.findings)
+        {
+            co_yield f;
+        }
+    }
+}
+
+Task<ScanResult> ScanFileAsync(const Scanner& scanner, std::filesystem::path p, ScanExecutor& executor, CancellationToken token)
+{
+    co_await Schedule(executor);
+
+    if (token.IsCancelled())
+    {
+        ScanResult r;
+        r.stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        r.stopped_early = true;
+        co_return r;
+    }
+
+    co_return scanner.ScanSingleFile(p);
+}
+}
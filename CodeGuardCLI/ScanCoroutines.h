@@ -0,0 +1,322 @@
+#pragma once
+
+#include "Scanner.h"
+
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace codeguard
+{
+class CancellationToken final
+{
+public:
+    CancellationToken() = default;
+    explicit CancellationToken(std::shared_ptr<std::atomic<bool>> f)
+        : flag(std::move(f))
+    {
+    }
+
+    bool IsCancelled() const
+    {
+        return flag && flag->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+class CancellationSource final
+{
+public:
+    CancellationSource()
+        : flag(std::make_shared<std::atomic<bool>>(false))
+    {
+    }
+
+    void Cancel()
+    {
+        flag->store(true, std::memory_order_relaxed);
+    }
+
+    CancellationToken Token() const
+    {
+        return CancellationToken(flag);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// Lazily evaluated: nothing runs until the first Next(); destroying it cancels the remaining work.
+template <typename T>
+class Generator final
+{
+public:
+    struct promise_type
+    {
+        const T* current = nullptr;
+        std::exception_ptr error;
+
+        Generator get_return_object()
+        {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value(const T& value) noexcept
+        {
+            current = std::addressof(value);
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            error = std::current_exception();
+        }
+    };
+
+    Generator(Generator&& other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    Generator& operator=(Generator&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+    ~Generator()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    // Resumes until the next value; returns false once the coroutine has finished.
+    bool Next()
+    {
+        if (!handle || handle.done())
+        {
+            return false;
+        }
+        handle.resume();
+        if (handle.promise().error)
+        {
+            std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+        }
+        return !handle.done();
+    }
+
+    // Valid until the next call to Next().
+    const T& Value() const
+    {
+        return *handle.promise().current;
+    }
+
+private:
+    explicit Generator(std::coroutine_handle<promise_type> h)
+        : handle(h)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Lazily started task; awaiting it from another coroutine chains via symmetric transfer.
+template <typename T>
+class Task final
+{
+public:
+    struct promise_type
+    {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object()
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                {
+                    const auto next = h.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept
+                {
+                }
+            };
+            return FinalAwaiter{};
+        }
+
+        void return_value(T v)
+        {
+            value = std::move(v);
+        }
+
+        void unhandled_exception()
+        {
+            error = std::current_exception();
+        }
+    };
+
+    Task(Task&& other) noexcept
+        : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return !handle || handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        return Result();
+    }
+
+    // For hosts that are not coroutines themselves: Start() once, poll Done(), then take Result().
+    void Start()
+    {
+        if (handle && !handle.done())
+        {
+            handle.resume();
+        }
+    }
+
+    bool Done() const
+    {
+        return !handle || handle.done();
+    }
+
+    T Result()
+    {
+        if (handle.promise().error)
+        {
+            std::rethrow_exception(handle.promise().error);
+        }
+        return std::move(*handle.promise().value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h)
+        : handle(h)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Host-provided scheduler; Post may be called from any thread.
+class ScanExecutor
+{
+public:
+    virtual ~ScanExecutor() = default;
+    virtual void Post(std::coroutine_handle<> h) = 0;
+};
+
+// Minimal executor for single-threaded event loops: the host calls RunPending() from its loop.
+class QueueExecutor final : public ScanExecutor
+{
+public:
+    void Post(std::coroutine_handle<> h) override;
+    bool RunOne();
+    size_t RunPending();
+
+private:
+    std::mutex mutex;
+    std::deque<std::coroutine_handle<>> queue;
+};
+
+inline auto Schedule(ScanExecutor& executor)
+{
+    struct ScheduleAwaiter
+    {
+        ScanExecutor& executor;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            executor.Post(h);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+    return ScheduleAwaiter{ executor };
+}
+
+// The scanner must outlive the returned coroutines; root and p are copied into the frame.
+Generator<Finding> ScanFindings(const Scanner& scanner, std::filesystem::path root, CancellationToken token = CancellationToken());
+Task<ScanResult> ScanFileAsync(const Scanner& scanner, std::filesystem::path p, ScanExecutor& executor, CancellationToken token = CancellationToken());
+}
@@ -1,17 +1,38 @@
 #include "Scanner.h"
 
 #include "Util.h"
+#include "FormatString.h"
+#include "Baseline.h"
+#include "History.h"
+#include "Archive.h"
+#include "Metrics.h"
+#include "CallIndex.h"
+#include "Checkpoint.h"
+#include "RegexRules.h"
 
 #include <iostream>
 #include <system_error>
 #include <cctype>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
 
 namespace codeguard
 {
 Scanner::Scanner()
 {
     root_path.clear();
-    options = { true, true };
+    options = { true, true, false, GeneratedFilePolicy::Scan, false };
+    run_options = { 0, 0, false, Severity::High };
+    baseline = nullptr;
+    history = nullptr;
+    metrics = nullptr;
+    call_index = nullptr;
+    checkpoint = nullptr;
+    regex_rules = nullptr;
     InitDefaultRules();
 }
 
@@ -25,6 +46,66 @@ void Scanner::SetOptions(const ScanOptions& opt)
     options = opt;
 }
 
+void Scanner::SetRunOptions(const RunOptions& opt)
+{
+    run_options = opt;
+}
+
+void Scanner::SetBaseline(const Baseline* b)
+{
+    baseline = b;
+}
+
+void Scanner::SetHistory(ScanHistory* h)
+{
+    history = h;
+}
+
+void Scanner::SetMetrics(ScanMetrics* m)
+{
+    metrics = m;
+}
+
+void Scanner::SetCallIndex(CallIndex* index)
+{
+    call_index = index;
+}
+
+void Scanner::SetCheckpoint(ScanCheckpoint* c)
+{
+    checkpoint = c;
+}
+
+void Scanner::SetRegexRules(const RegexRuleSet* rules)
+{
+    regex_rules = rules;
+    user_rule_ids.clear();
+    for (size_t r = 0; rules != nullptr && r < rules->Size(); r++)
+    {
+        user_rule_ids.insert(rules->Rule(r).rule_id);
+    }
+}
+
+uint64_t Scanner::RunSignature() const
+{
+    std::string s = PathToUtf8(root_path.lexically_normal());
+    s.push_back(options.check_banned_functions ? '1' : '0');
+    s.push_back(options.check_scanf_unsafe_percent_s ? '1' : '0');
+    s.push_back(options.check_printf_percent_n ? '1' : '0');
+    s.push_back(static_cast<char>('0' + static_cast<int>(options.generated_files)));
+    s.push_back(options.scan_archives ? '1' : '0');
+    AppendU64(s, (baseline != nullptr) ? baseline->ContentHash() : 0);
+    if (regex_rules != nullptr)
+    {
+        for (size_t r = 0; r < regex_rules->Size(); r++)
+        {
+            s += regex_rules->Rule(r).rule_id;
+            s += regex_rules->Rule(r).pattern;
+        }
+    }
+    return HashBytes(s, 0);
+}
+
 void Scanner::InitDefaultRules()
 {
     banned_functions = {
@@ -36,10 +117,20 @@ void Scanner::InitDefaultRules()
         "system",
         "popen"
     };
+
+    format_functions.clear();
+    std::vector<std::string> triggers = banned_functions;
+    for (const auto& fn : FormatFunctionTable())
+    {
+        format_functions.emplace(std::string_view(fn.name), &fn);
+        triggers.emplace_back(fn.name);
+    }
+    prefilter.Build(triggers);
 }
 
 static void AddFinding(
     ScanResult& out,
+    const SuppressionTable& suppressions,
     const std::filesystem::path& file_path,
     size_t line,
     size_t col,
@@ -49,6 +140,12 @@ static void AddFinding(
     std::string_view line_text
 )
 {
+    if (!suppressions.ranges.empty() && suppressions.IsSuppressed(line, rule_id))
+    {
+        out.stats.findings_suppressed++;
+        return;
+    }
+
     Finding f;
     f.file_path = file_path;
     f.line = line;
@@ -61,6 +158,32 @@ static void AddFinding(
     out.stats.findings++;
 }
 
+static void MergeStats(ScanStats& into, const ScanStats& from)
+{
+    into.files_seen += from.files_seen;
+    into.files_scanned += from.files_scanned;
+    into.bytes_scanned += from.bytes_scanned;
+    into.findings += from.findings;
+    into.findings_baselined += from.findings_baselined;
+    into.findings_suppressed += from.findings_suppressed;
+    into.files_binary += from.files_binary;
+    into.files_utf16 += from.files_utf16;
+    into.files_generated += from.files_generated;
+    into.archives_scanned += from.archives_scanned;
+    into.files_prefiltered += from.files_prefiltered;
+    into.archives_unreadable += from.archives_unreadable;
+}
+
+static Severity BannedSeverity(const std::string& name)
+{
+    return (name == "gets" || name == "strcpy" || name == "strcat" || name == "sprintf" || name == "vsprintf") ? Severity::High : Severity::Medium;
+}
+
+static uint64_t ElapsedNs(std::chrono::steady_clock::time_point since)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
 static size_t SkipSpaces(const std::string& s, size_t i)
 {
     while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\r' || s[i] == '\n'))
@@ -157,10 +280,81 @@ static std::string ReadStringLiteralAt(const std::string& raw, size_t& i)
     return out;
 }
 
+static size_t SkipBlank(const std::string& raw, const std::string& sanitized, size_t i)
+{
+    while (i < sanitized.size() && raw[i] != '"' && (sanitized[i] == ' ' || sanitized[i] == '\t' || sanitized[i] == '\r' || sanitized[i] == '\n'))
+    {
+        i++;
+    }
+    return i;
+}
+
+static bool SkipArguments(const std::string& sanitized, size_t& i, size_t count)
+{
+    int depth = 0;
+    while (count > 0 && i < sanitized.size())
+    {
+        const char c = sanitized[i];
+        if (c == '(' || c == '[' || c == '{')
+        {
+            depth++;
+        }
+        else if (c == ')' || c == ']' || c == '}')
+        {
+            if (depth == 0)
+            {
+                return false;
+            }
+            depth--;
+        }
+        else if (c == ',' && depth == 0)
+        {
+            count--;
+        }
+        i++;
+    }
+    return count == 0;
+}
+
+static size_t StringLiteralPrefixLength(const std::string& raw, size_t i, bool wide)
+{
+    if (wide)
+    {
+        return (raw.compare(i, 2, "L\"") == 0) ? 1 : std::string::npos;
+    }
+    if (i < raw.size() && raw[i] == '"')
+    {
+        return 0;
+    }
+    return (raw.compare(i, 3, "u8\"") == 0) ? 2 : std::string::npos;
+}
+
+// Reads a format argument made of one or more adjacent string literals.
+static bool ReadFormatLiteral(const std::string& raw, const std::string& sanitized, size_t& i, bool wide, std::string& fmt)
+{
+    bool any = false;
+    while (true)
+    {
+        i = SkipBlank(raw, sanitized, i);
+        const size_t prefix = StringLiteralPrefixLength(raw, i, wide);
+        if (prefix == std::string::npos)
+        {
+            break;
+        }
+        i += prefix;
+        fmt += ReadStringLiteralAt(raw, i);
+        any = true;
+    }
+    return any;
+}
+
 ScanResult Scanner::Run()
 {
+    const auto run_started = std::chrono::steady_clock::now();
+
     ScanResult out;
-    out.stats = { 0, 0, 0, 0 };
+    out.stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    out.stopped_early = false;
 
     std::error_code ec;
     if (root_path.empty() || !std::filesystem::exists(root_path, ec) || !std::filesystem::is_directory(root_path, ec))
@@ -176,6 +370,7 @@ ScanResult Scanner::Run()
 
     const auto end = std::filesystem::recursive_directory_iterator();
 
+    std::vector<std::filesystem::path> files;
     for (; it != end; it.increment(ec))
     {
         if (ec)
@@ -193,52 +388,617 @@ ScanResult Scanner::Run()
         }
 
         const auto p = entry.path();
-        if (!IsLikelyTextFileExtension(p))
+        if (!IsCandidate(p))
+        {
+            continue;
+        }
+
+        files.push_back(p);
+    }
+
+    std::vector<uint64_t> keys;
+    std::vector<size_t> order(files.size());
+    std::iota(order.begin(), order.end(), size_t(0));
+
+    if (history != nullptr || checkpoint != nullptr)
+    {
+        keys.reserve(files.size());
+        for (const auto& p : files)
+        {
+            keys.push_back(ScanHistory::PathKey(p, root_path));
+        }
+    }
+
+    if (history != nullptr)
+    {
+        std::vector<uint32_t> scores;
+        scores.reserve(files.size());
+        for (const uint64_t key : keys)
+        {
+            scores.push_back(history->Score(key));
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return scores[a] > scores[b];
+        });
+    }
+
+    if (call_index != nullptr)
+    {
+        call_index->BeginUpdate();
+    }
+
+    std::vector<ScanResult> per_file(files.size());
+    std::vector<char> visited(files.size(), 0);
+    std::vector<size_t> deferred;
+    std::mutex deferred_mutex;
+    std::atomic<size_t> next(0);
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> total_findings(0);
+
+    // Files restored from the checkpoint are not scanned again unless their size or mtime changed;
+    // with a call index they are still read so their definitions make it into this run's index.
+    // A restored result that would have stopped the original run stops this one too, before any
+    // pending file is scanned.
+    std::vector<char> restored(files.size(), 0);
+    std::vector<size_t> pending;
+    std::vector<uint64_t> stamps;
+    if (checkpoint != nullptr)
+    {
+        pending.reserve(order.size());
+        stamps.resize(files.size());
+        for (const size_t i : order)
+        {
+            stamps[i] = ScanCheckpoint::FileStamp(files[i]);
+            if (checkpoint->Take(keys[i], stamps[i], per_file[i]))
+            {
+                restored[i] = 1;
+                visited[i] = 1;
+                const uint64_t total = total_findings.fetch_add(per_file[i].stats.findings) + per_file[i].stats.findings;
+                if (ShouldStop(per_file[i], total))
+                {
+                    stop.store(true, std::memory_order_relaxed);
+                }
+                if (call_index == nullptr)
+                {
+                    continue;
+                }
+            }
+            pending.push_back(i);
+        }
+    }
+
+    const std::vector<size_t>* queue = (checkpoint != nullptr) ? &pending : &order;
+    bool defer_generated = (options.generated_files == GeneratedFilePolicy::Defer);
+
+    const auto worker = [&]()
+    {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            const size_t n = next.fetch_add(1, std::memory_order_relaxed);
+            if (n >= queue->size())
+            {
+                break;
+            }
+
+            const size_t i = (*queue)[n];
+            if (restored[i])
+            {
+                IndexFile(files[i]);
+                continue;
+            }
+
+            ScanResult& r = per_file[i];
+            r.stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+            const auto started = std::chrono::steady_clock::now();
+            const FileDisposition disposition = ScanFile(files[i], r, defer_generated);
+            if (disposition == FileDisposition::Deferred)
+            {
+                std::lock_guard<std::mutex> lock(deferred_mutex);
+                deferred.push_back(i);
+                continue;
+            }
+
+            if (baseline != nullptr)
+            {
+                ApplyBaseline(r, *baseline, root_path);
+            }
+            visited[i] = 1;
+
+            if (metrics != nullptr)
+            {
+                SkipReason reason = SkipReason::None;
+                if (disposition == FileDisposition::Skipped)
+                {
+                    reason = (r.stats.files_binary > 0) ? SkipReason::Binary
+                        : (r.stats.files_generated > 0) ? SkipReason::Generated
+                        : SkipReason::Unreadable;
+                }
+                metrics->RecordFile(r, reason, ElapsedNs(started));
+            }
+
+            if (checkpoint != nullptr)
+            {
+                checkpoint->Append(keys[i], stamps[i], r);
+            }
+
+            const uint64_t total = total_findings.fetch_add(r.stats.findings, std::memory_order_relaxed) + r.stats.findings;
+            if (ShouldStop(r, total))
+            {
+                stop.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    uint32_t thread_count = run_options.threads;
+    if (thread_count == 0)
+    {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    thread_count = static_cast<uint32_t>(std::min<size_t>(thread_count, std::max<size_t>(files.size(), 1)));
+
+    const auto run_workers = [&]()
+    {
+        std::vector<std::thread> threads;
+        for (uint32_t t = 1; t < thread_count; t++)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+    };
+
+    run_workers();
+
+    if (!deferred.empty() && !stop.load())
+    {
+        std::vector<size_t> rank(files.size());
+        for (size_t n = 0; n < order.size(); n++)
+        {
+            rank[order[n]] = n;
+        }
+        std::sort(deferred.begin(), deferred.end(), [&](size_t a, size_t b)
+        {
+            return rank[a] < rank[b];
+        });
+        queue = &deferred;
+        defer_generated = false;
+        next.store(0);
+        run_workers();
+    }
+
+    if (checkpoint != nullptr)
+    {
+        checkpoint->Flush();
+    }
+
+    out.stopped_early = stop.load();
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (!visited[i])
         {
             continue;
         }
 
-        ScanFile(p, out);
+        ScanResult& r = per_file[i];
+        MergeStats(out.stats, r.stats);
+        out.findings.insert(out.findings.end(), std::make_move_iterator(r.findings.begin()), std::make_move_iterator(r.findings.end()));
+
+        if (history != nullptr && r.stats.files_scanned > 0)
+        {
+            history->Record(keys[i], r.stats.findings);
+        }
+    }
+
+    if (call_index != nullptr)
+    {
+        call_index->CommitUpdate(!out.stopped_early);
+        if (!out.stopped_early && options.check_banned_functions)
+        {
+            ReportWrapperCalls(out);
+        }
+    }
+
+    if (metrics != nullptr)
+    {
+        metrics->RecordRun(out, ElapsedNs(run_started));
     }
 
     return out;
 }
 
-void Scanner::ScanFile(const std::filesystem::path& p, ScanResult& out)
+bool Scanner::IsCandidate(const std::filesystem::path& p) const
+{
+    return IsLikelyTextFileExtension(p) || (options.scan_archives && IsArchivePath(p));
+}
+
+ScanResult Scanner::ScanSingleFile(const std::filesystem::path& p) const
+{
+    ScanResult out;
+    out.stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    out.stopped_early = false;
+
+    ScanFile(p, out, false);
+    if (baseline != nullptr)
+    {
+        ApplyBaseline(out, *baseline, root_path);
+    }
+    return out;
+}
+
+bool Scanner::ShouldStop(const ScanResult& file_result, uint64_t total_findings) const
+{
+    if (run_options.max_findings > 0 && total_findings >= run_options.max_findings)
+    {
+        return true;
+    }
+
+    if (run_options.stop_on_severity)
+    {
+        for (const auto& f : file_result.findings)
+        {
+            if (static_cast<int>(f.severity) >= static_cast<int>(run_options.stop_severity))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+ScanStats Scanner::ScanBuffer(const std::filesystem::path& virtual_path, std::string_view text, const FindingCallback& on_finding) const
+{
+    ScanResult out;
+    out.stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    out.stopped_early = false;
+
+    std::string raw(text);
+    FileDisposition disposition = FileDisposition::Scanned;
+    if (!PrepareText(raw, false, out.stats, disposition))
+    {
+        return out.stats;
+    }
+
+    ScanText(virtual_path, raw, out);
+
+    if (on_finding)
+    {
+        for (const auto& f : out.findings)
+        {
+            on_finding(f);
+        }
+    }
+
+    return out.stats;
+}
+
+Scanner::FileDisposition Scanner::ScanFile(const std::filesystem::path& p, ScanResult& out, bool defer_generated) const
 {
+    if (options.scan_archives && IsArchivePath(p))
+    {
+        ScanArchive(p, out);
+        return FileDisposition::Scanned;
+    }
+
+    // Only the head is needed to classify the file; the rest is read once it is known to be scanned.
     std::string raw;
     std::string err;
-    if (!ReadFileAll(p, raw, err))
+    uint64_t size = 0;
+    if (!ReadFileHead(p, kSniffBytes, raw, size, err))
+    {
+        return FileDisposition::Skipped;
+    }
+
+    FileDisposition disposition = FileDisposition::Scanned;
+    const auto read_rest = [&](std::string& text)
+    {
+        return text.size() >= size || ReadFileAll(p, text, err);
+    };
+    if (!PrepareText(raw, defer_generated, out.stats, disposition, read_rest))
+    {
+        return disposition;
+    }
+
+    ScanText(p, raw, out);
+    return FileDisposition::Scanned;
+}
+
+// Members are reported as "archive.tar.gz!/path/in/archive.c".
+void Scanner::ScanArchive(const std::filesystem::path& p, ScanResult& out) const
+{
+    const std::string prefix = PathToUtf8(p) + "!/";
+
+    std::string err;
+    const bool ok = ReadTarArchive(
+        p,
+        [&](const ArchiveEntry& e)
+        {
+            return e.size <= kMaxSourceBytes && IsLikelyTextFileExtension(PathFromUtf8(e.path));
+        },
+        [&](const ArchiveEntry& e, std::string& content)
+        {
+            FileDisposition disposition = FileDisposition::Scanned;
+            if (PrepareText(content, false, out.stats, disposition))
+            {
+                ScanText(PathFromUtf8(prefix + e.path), content, out);
+            }
+        },
+        err
+    );
+
+    // Members read before a truncated or corrupt stream keep their findings, but the archive is
+    // counted as unreadable so the run does not look complete.
+    if (ok)
+    {
+        out.stats.archives_scanned++;
+    }
+    else
+    {
+        out.stats.archives_unreadable++;
+    }
+}
+
+// Call-index extraction only, for files whose findings were restored from a checkpoint.
+void Scanner::IndexFile(const std::filesystem::path& p) const
+{
+    ScanStats scratch = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    FileDisposition disposition = FileDisposition::Scanned;
+    const auto index_text = [&](const std::filesystem::path& file_path, std::string& raw)
+    {
+        if (!PrepareText(raw, false, scratch, disposition))
+        {
+            return;
+        }
+
+        const uint64_t path_key = ScanHistory::PathKey(file_path, root_path);
+        const uint64_t content_hash = HashBytes(raw, 0);
+        if (call_index->Reuse(path_key, content_hash, PathToUtf8(file_path)))
+        {
+            return;
+        }
+
+        SuppressionTable suppressions;
+        suppressions.user_rule_ids = &user_rule_ids;
+        const std::string sanitized = SanitizeKeepLayout(raw, &suppressions);
+        const auto idx = LineIndex::Build(raw);
+        if (!suppressions.Empty())
+        {
+            suppressions.Resolve(idx);
+        }
+        StageFunctions(file_path, raw, sanitized, idx, suppressions, path_key, content_hash);
+    };
+
+    std::string err;
+    if (options.scan_archives && IsArchivePath(p))
     {
+        const std::string prefix = PathToUtf8(p) + "!/";
+        ReadTarArchive(
+            p,
+            [&](const ArchiveEntry& e)
+            {
+                return e.size <= kMaxSourceBytes && IsLikelyTextFileExtension(PathFromUtf8(e.path));
+            },
+            [&](const ArchiveEntry& e, std::string& content)
+            {
+                index_text(PathFromUtf8(prefix + e.path), content);
+            },
+            err
+        );
         return;
     }
 
+    std::string raw;
+    if (ReadFileAll(p, raw, err))
+    {
+        index_text(p, raw);
+    }
+}
+
+void Scanner::StageFunctions(
+    const std::filesystem::path& file_path,
+    const std::string& raw,
+    const std::string& sanitized,
+    const LineIndex& idx,
+    const SuppressionTable& suppressions,
+    uint64_t path_key,
+    uint64_t content_hash
+) const
+{
+    IndexedFile entry;
+    entry.path_key = path_key;
+    entry.content_hash = content_hash;
+    entry.path = PathToUtf8(file_path);
+    CallIndex::ExtractFunctions(raw, sanitized, idx, suppressions, entry.functions);
+    call_index->Stage(std::move(entry));
+}
+
+// Sniffs the head of raw: drops binaries, transcodes UTF-16 in place and applies the generated-file policy.
+bool Scanner::PrepareText(
+    std::string& raw,
+    bool defer_generated,
+    ScanStats& stats,
+    FileDisposition& disposition,
+    const std::function<bool(std::string&)>& read_rest
+) const
+{
+    size_t bom_size = 0;
+    const TextEncoding enc = DetectEncoding(raw, bom_size);
+
+    if (enc == TextEncoding::Binary)
+    {
+        stats.files_binary++;
+        disposition = FileDisposition::Skipped;
+        return false;
+    }
+
+    // Generated files are detected and counted under every policy; the policy only decides what happens next.
+    const auto keep_generated = [&]()
+    {
+        if (!HasGeneratedMarker(raw))
+        {
+            return true;
+        }
+        if (defer_generated)
+        {
+            disposition = FileDisposition::Deferred;
+            return false;
+        }
+
+        stats.files_generated++;
+        if (options.generated_files == GeneratedFilePolicy::Skip)
+        {
+            disposition = FileDisposition::Skipped;
+            return false;
+        }
+        return true;
+    };
+
+    // Markers are only looked for in the head, so UTF-8 files can be dropped before the rest is read;
+    // UTF-16 heads are checked after transcoding, as before.
+    const bool utf16 = (enc == TextEncoding::Utf16LE || enc == TextEncoding::Utf16BE);
+    if (!utf16 && !keep_generated())
+    {
+        return false;
+    }
+
+    if (read_rest && !read_rest(raw))
+    {
+        disposition = FileDisposition::Skipped;
+        return false;
+    }
+
+    if (utf16)
+    {
+        raw = TranscodeUtf16ToUtf8(std::string_view(raw).substr(bom_size), enc == TextEncoding::Utf16BE);
+        if (!keep_generated())
+        {
+            return false;
+        }
+        stats.files_utf16++;
+    }
+
+    disposition = FileDisposition::Scanned;
+    return true;
+}
+
+void Scanner::ScanText(const std::filesystem::path& file_path, const std::string& raw, ScanResult& out) const
+{
     out.stats.files_scanned++;
     out.stats.bytes_scanned += static_cast<uint64_t>(raw.size());
 
-    std::string sanitized = SanitizeKeepLayout(raw);
+    // Every rule needs one of the trigger names somewhere in the file, even if only inside a comment.
+    std::vector<size_t> candidates;
+    prefilter.FindCandidates(raw, candidates);
+
+    // Calls to in-house wrappers carry no trigger name, so indexing cannot take the prefilter fast path.
+    uint64_t path_key = 0;
+    uint64_t content_hash = 0;
+    bool reindex = false;
+    if (call_index != nullptr)
+    {
+        path_key = ScanHistory::PathKey(file_path, root_path);
+        content_hash = HashBytes(raw, 0);
+        reindex = !call_index->Reuse(path_key, content_hash, PathToUtf8(file_path));
+    }
+
+    // Regex rules carry their own required literals; a rule without any keeps every file on the slow path.
+    const bool literal_rules = !candidates.empty();
+    std::vector<char> regex_candidates;
+    const bool regex_candidate = regex_rules != nullptr && regex_rules->FindCandidates(raw, regex_candidates);
+    if (!literal_rules && !reindex && !regex_candidate)
+    {
+        out.stats.files_prefiltered++;
+        return;
+    }
+
+    SuppressionTable suppressions;
+    suppressions.user_rule_ids = &user_rule_ids;
+    const std::string sanitized = SanitizeKeepLayout(raw, &suppressions);
+    const auto idx = LineIndex::Build(raw);
+
+    if (!suppressions.Empty())
+    {
+        suppressions.Resolve(idx);
+    }
+
+    if (reindex)
+    {
+        StageFunctions(file_path, raw, sanitized, idx, suppressions, path_key, content_hash);
+    }
+
+    if (literal_rules && options.check_banned_functions)
+    {
+        FindBannedFunctionCalls(file_path, raw, sanitized, idx, suppressions, out);
+    }
 
-    if (options.check_banned_functions)
+    if (literal_rules && (options.check_scanf_unsafe_percent_s || options.check_printf_percent_n))
     {
-        FindBannedFunctionCalls(p, raw, sanitized, out);
+        FindFormatStringIssues(file_path, raw, sanitized, idx, suppressions, candidates, out);
     }
 
-    if (options.check_scanf_unsafe_percent_s)
+    if (regex_candidate)
     {
-        FindScanfUnsafePercentS(p, raw, sanitized, out);
+        FindRegexIssues(file_path, raw, sanitized, idx, suppressions, regex_candidates, out);
     }
 }
 
+// Wrapper call sites are only known once every file is indexed, so the line text is read back here.
+void Scanner::ReportWrapperCalls(ScanResult& out) const
+{
+    ScanResult wrappers;
+    wrappers.stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    wrappers.stopped_early = false;
+
+    call_index->FindWrapperCalls(banned_functions, [&](const IndexedFile& file, const CallSite& site, const std::vector<std::string>& chain)
+    {
+        if (site.suppressed)
+        {
+            wrappers.stats.findings_suppressed++;
+            return;
+        }
+
+        std::string path_text;
+        for (const auto& name : chain)
+        {
+            path_text += path_text.empty() ? name : " -> " + name;
+        }
+
+        Finding f;
+        f.file_path = PathFromUtf8(file.path);
+        f.line = site.line;
+        f.column = site.column;
+        f.rule_id = "CG0004";
+        f.severity = BannedSeverity(chain.back());
+        f.message = "call to " + site.callee + " reaches banned function " + chain.back() + " (" + path_text + ")";
+        f.line_text = site.line_text;
+        wrappers.findings.push_back(std::move(f));
+        wrappers.stats.findings++;
+    });
+
+    if (baseline != nullptr)
+    {
+        ApplyBaseline(wrappers, *baseline, root_path);
+    }
+
+    MergeStats(out.stats, wrappers.stats);
+    out.findings.insert(out.findings.end(), std::make_move_iterator(wrappers.findings.begin()), std::make_move_iterator(wrappers.findings.end()));
+}
+
 void Scanner::FindBannedFunctionCalls(
     const std::filesystem::path& file_path,
     const std::string& raw,
     const std::string& sanitized,
+    const LineIndex& idx,
+    const SuppressionTable& suppressions,
     ScanResult& out
-)
+) const
 {
-    (void)raw;
-
-    const auto idx = LineIndex::Build(raw);
 
     for (const auto& name : banned_functions)
     {
@@ -258,10 +1018,10 @@ void Scanner::FindBannedFunctionCalls(
                 const size_t col = idx.ColFromIndex(found, line);
 
                 const std::string rule_id = "CG0001";
-                const Severity sev = (name == "gets" || name == "strcpy" || name == "strcat" || name == "sprintf" || name == "vsprintf") ? Severity::High : Severity::Medium;
+                const Severity sev = BannedSeverity(name);
                 const std::string msg = "banned function call detected: " + name;
 
-                AddFinding(out, file_path, line, col, rule_id, sev, msg, idx.LineText(raw, line));
+                AddFinding(out, suppressions, file_path, line, col, rule_id, sev, msg, idx.LineText(raw, line));
             }
 
             pos = found + name_len;
@@ -269,130 +1029,164 @@ void Scanner::FindBannedFunctionCalls(
     }
 }
 
-bool Scanner::HasUnsafePercentS(const std::string& fmt)
+void Scanner::FindRegexIssues(
+    const std::filesystem::path& file_path,
+    const std::string& raw,
+    const std::string& sanitized,
+    const LineIndex& idx,
+    const SuppressionTable& suppressions,
+    const std::vector<char>& candidates,
+    ScanResult& out
+) const
 {
-    for (size_t i = 0; i < fmt.size(); i++)
+    const auto report = [&](size_t rule, size_t start)
     {
-        if (fmt[i] != '%')
-        {
-            continue;
-        }
-
-        if (i + 1 < fmt.size() && fmt[i + 1] == '%')
-        {
-            i++;
-            continue;
-        }
-
-        i++;
-
-        bool suppressed = false;
-        if (i < fmt.size() && fmt[i] == '*')
-        {
-            suppressed = true;
-            i++;
-        }
+        const RegexRule& r = regex_rules->Rule(rule);
+        const size_t line = idx.LineFromIndex(start);
+        const size_t col = idx.ColFromIndex(start, line);
+        AddFinding(out, suppressions, file_path, line, col, r.rule_id, r.severity, "matches pattern " + r.pattern, idx.LineText(raw, line));
+    };
 
-        bool hasWidth = false;
-        while (i < fmt.size() && std::isdigit(static_cast<unsigned char>(fmt[i])))
+    if (regex_rules->HasTarget(RegexTarget::Code, candidates))
+    {
+        regex_rules->Match(RegexTarget::Code, sanitized, candidates, [&](size_t rule, size_t start, size_t)
         {
-            hasWidth = true;
-            i++;
-        }
+            report(rule, start);
+        });
+    }
 
-        if (i < fmt.size() && (fmt[i] == 'h' || fmt[i] == 'l' || fmt[i] == 'j' || fmt[i] == 'z' || fmt[i] == 't' || fmt[i] == 'L'))
+    if (regex_rules->HasTarget(RegexTarget::Text, candidates))
+    {
+        // The sanitizer blanks exactly the literal and comment bytes, so keeping only the bytes it
+        // changed leaves literals and comments (with their delimiters) at their original offsets.
+        std::string text(raw.size(), ' ');
+        for (size_t i = 0; i < raw.size(); i++)
         {
-            const char first = fmt[i];
-            i++;
-            if (i < fmt.size() && (fmt[i] == first) && (first == 'h' || first == 'l'))
+            if (raw[i] == '\n' || sanitized[i] != raw[i])
             {
-                i++;
+                text[i] = raw[i];
             }
         }
 
-        if (i >= fmt.size())
+        regex_rules->Match(RegexTarget::Text, text, candidates, [&](size_t rule, size_t start, size_t)
         {
-            break;
-        }
+            report(rule, start);
+        });
+    }
+}
 
-        const char conv = fmt[i];
-        if (conv == 's')
+bool Scanner::HasUnsafePercentS(const std::string& fmt)
+{
+    for (const auto& spec : ParseFormatString(fmt, FormatFamily::Scan))
+    {
+        const bool unbounded = (spec.conversion == 's' || spec.conversion == 'S' || spec.conversion == '[');
+        if (unbounded && !spec.suppressed && !spec.has_width)
         {
-            if (!suppressed && !hasWidth)
-            {
-                return true;
-            }
+            return true;
         }
     }
+    return false;
+}
 
+bool Scanner::HasPercentN(const std::string& fmt)
+{
+    for (const auto& spec : ParseFormatString(fmt, FormatFamily::Print))
+    {
+        if (spec.conversion == 'n')
+        {
+            return true;
+        }
+    }
     return false;
 }
 
-void Scanner::FindScanfUnsafePercentS(
+void Scanner::FindFormatStringIssues(
     const std::filesystem::path& file_path,
     const std::string& raw,
     const std::string& sanitized,
+    const LineIndex& idx,
+    const SuppressionTable& suppressions,
+    const std::vector<size_t>& candidates,
     ScanResult& out
-)
+) const
 {
-    const auto idx = LineIndex::Build(raw);
-
-    const std::string name = "scanf";
-    const size_t name_len = name.size();
-
+    // Every format function name contains a prefilter anchor, so only identifiers around a candidate can match.
     size_t pos = 0;
-    while (pos < sanitized.size())
+    for (const size_t hit : candidates)
     {
-        const size_t found = sanitized.find(name, pos);
-        if (found == std::string::npos)
+        if (hit < pos || !IsIdentChar(static_cast<unsigned char>(sanitized[hit])))
         {
-            break;
+            continue;
         }
 
-        if (!LooksLikeCallAt(sanitized, found, name_len))
+        size_t name_pos = hit;
+        while (name_pos > 0 && IsIdentChar(static_cast<unsigned char>(sanitized[name_pos - 1])))
+        {
+            name_pos--;
+        }
+
+        pos = hit;
+        while (pos < sanitized.size() && IsIdentChar(static_cast<unsigned char>(sanitized[pos])))
+        {
+            pos++;
+        }
+
+        const auto it = format_functions.find(std::string_view(sanitized.data() + name_pos, pos - name_pos));
+        if (it == format_functions.end())
         {
-            pos = found + name_len;
             continue;
         }
 
-        size_t i = found + name_len;
-        i = SkipSpaces(raw, i);
-        if (i >= raw.size() || raw[i] != '(')
+        const FormatFunction& fn = *it->second;
+        const bool isScan = (fn.family == FormatFamily::Scan);
+        if ((isScan && !options.check_scanf_unsafe_percent_s) || (!isScan && !options.check_printf_percent_n))
         {
-            pos = found + name_len;
             continue;
         }
 
-        i++;
-        i = SkipSpaces(raw, i);
+        // scanf_s and friends take a buffer size for every %s/%[, which is the recommended fix for CG0002.
+        if (isScan && fn.bounded)
+        {
+            continue;
+        }
 
-        if (i >= raw.size() || raw[i] != '"')
+        size_t i = SkipSpaces(sanitized, pos);
+        if (i >= sanitized.size() || sanitized[i] != '(')
         {
-            pos = found + name_len;
             continue;
         }
 
-        size_t fmt_start = i;
-        std::string fmt = ReadStringLiteralAt(raw, i);
-        if (fmt.empty())
+        i++;
+        if (!SkipArguments(sanitized, i, fn.format_arg))
         {
-            pos = found + name_len;
             continue;
         }
 
-        if (HasUnsafePercentS(fmt))
+        i = SkipBlank(raw, sanitized, i);
+        const size_t fmt_start = i;
+        std::string fmt;
+        if (!ReadFormatLiteral(raw, sanitized, i, fn.wide, fmt) || fmt.empty())
         {
-            const size_t line = idx.LineFromIndex(fmt_start);
-            const size_t col = idx.ColFromIndex(fmt_start, line);
+            continue;
+        }
 
-            const std::string rule_id = "CG0002";
-            const Severity sev = Severity::High;
-            const std::string msg = "scanf format uses %s without width (potential overflow)";
+        const size_t line = idx.LineFromIndex(fmt_start);
+        const size_t col = idx.ColFromIndex(fmt_start, line);
+        const std::string name(fn.name);
 
-            AddFinding(out, file_path, line, col, rule_id, sev, msg, idx.LineText(raw, line));
+        if (isScan && HasUnsafePercentS(fmt))
+        {
+            const std::string msg = name + " format uses %s/%[ without width (potential overflow)";
+            AddFinding(out, suppressions, file_path, line, col, "CG0002", Severity::High, msg, idx.LineText(raw, line));
         }
 
-        pos = found + name_len;
+        if (!isScan && HasPercentN(fmt))
+        {
+            const Severity sev = fn.bounded ? Severity::Low : Severity::High;
+            const std::string msg = name + " format uses %n (writes to memory through argument)";
+
+            AddFinding(out, suppressions, file_path, line, col, "CG0003", sev, msg, idx.LineText(raw, line));
+        }
     }
 }
 
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Prefilter.h"
 
 namespace codeguard
 {
@@ -30,20 +37,60 @@ struct ScanStats
     uint64_t files_scanned;
     uint64_t bytes_scanned;
     uint64_t findings;
+    uint64_t findings_baselined;
+    uint64_t findings_suppressed;
+    uint64_t files_binary;
+    uint64_t files_utf16;
+    uint64_t files_generated;
+    uint64_t archives_scanned;
+    uint64_t files_prefiltered;
+    uint64_t archives_unreadable;
 };
 
 struct ScanResult
 {
     std::vector<Finding> findings;
     ScanStats stats;
+    bool stopped_early;
+};
+
+enum class GeneratedFilePolicy
+{
+    Scan,
+    Skip,
+    Defer
 };
 
 struct ScanOptions
 {
     bool check_banned_functions;
     bool check_scanf_unsafe_percent_s;
+    bool check_printf_percent_n;
+    GeneratedFilePolicy generated_files;
+    bool scan_archives;
+};
+
+// Controls Scanner::Run only; ScanBuffer ignores these.
+struct RunOptions
+{
+    uint32_t threads;
+    uint64_t max_findings;
+    bool stop_on_severity;
+    Severity stop_severity;
 };
 
+using FindingCallback = std::function<void(const Finding&)>;
+
+struct LineIndex;
+struct SuppressionTable;
+struct FormatFunction;
+class Baseline;
+class ScanHistory;
+class ScanMetrics;
+class CallIndex;
+class ScanCheckpoint;
+class RegexRuleSet;
+
 class Scanner final
 {
 public:
@@ -51,34 +98,119 @@ public:
 
     void SetRoot(const std::filesystem::path& root);
     void SetOptions(const ScanOptions& opt);
+    void SetRunOptions(const RunOptions& opt);
+    void SetBaseline(const Baseline* baseline);
+    void SetHistory(ScanHistory* history);
+    // Run() reports per-file and per-run figures here when set.
+    void SetMetrics(ScanMetrics* metrics);
+    // Run() indexes definitions and calls into it and reports call sites of wrappers around banned functions (CG0004).
+    void SetCallIndex(CallIndex* index);
+    // Run() takes completed files from it instead of scanning them and appends every file it finishes.
+    void SetCheckpoint(ScanCheckpoint* checkpoint);
+    // Compiled user rules, evaluated on every scanned file next to the built-in rules.
+    void SetRegexRules(const RegexRuleSet* rules);
+
+    // Identifies root, options and baseline; a checkpoint is only resumed under the same signature.
+    uint64_t RunSignature() const;
 
     ScanResult Run();
 
+    // Scans an in-memory buffer as if it were the file at virtual_path.
+    // Safe to call concurrently from multiple threads as long as SetRoot/SetOptions are not called meanwhile.
+    ScanStats ScanBuffer(const std::filesystem::path& virtual_path, std::string_view text, const FindingCallback& on_finding) const;
+
+    // Building blocks for callers that drive traversal themselves (see ScanCoroutines.h).
+    bool IsCandidate(const std::filesystem::path& p) const;
+    ScanResult ScanSingleFile(const std::filesystem::path& p) const;
+
 private:
     std::filesystem::path root_path;
     ScanOptions options;
+    RunOptions run_options;
+    const Baseline* baseline;
+    ScanHistory* history;
+    ScanMetrics* metrics;
+    CallIndex* call_index;
+    ScanCheckpoint* checkpoint;
+    const RegexRuleSet* regex_rules;
+    std::unordered_set<std::string> user_rule_ids;
 
     std::vector<std::string> banned_functions;
+    std::unordered_map<std::string_view, const FormatFunction*> format_functions;
+    LiteralPrefilter prefilter;
 
     void InitDefaultRules();
 
-    void ScanFile(const std::filesystem::path& p, ScanResult& out);
+    enum class FileDisposition
+    {
+        Scanned,
+        Skipped,
+        Deferred
+    };
+
+    FileDisposition ScanFile(const std::filesystem::path& p, ScanResult& out, bool defer_generated) const;
+
+    void ScanArchive(const std::filesystem::path& p, ScanResult& out) const;
+
+    void IndexFile(const std::filesystem::path& p) const;
+
+    void StageFunctions(
+        const std::filesystem::path& file_path,
+        const std::string& raw,
+        const std::string& sanitized,
+        const LineIndex& idx,
+        const SuppressionTable& suppressions,
+        uint64_t path_key,
+        uint64_t content_hash
+    ) const;
+
+    // When read_rest is given, raw holds only the head of the file and read_rest is called to complete it
+    // once the file is known to be scanned.
+    bool PrepareText(
+        std::string& raw,
+        bool defer_generated,
+        ScanStats& stats,
+        FileDisposition& disposition,
+        const std::function<bool(std::string&)>& read_rest = nullptr
+    ) const;
+
+    bool ShouldStop(const ScanResult& file_result, uint64_t total_findings) const;
+
+    void ScanText(const std::filesystem::path& file_path, const std::string& raw, ScanResult& out) const;
+
+    void ReportWrapperCalls(ScanResult& out) const;
 
     void FindBannedFunctionCalls(
         const std::filesystem::path& file_path,
         const std::string& raw,
         const std::string& sanitized,
+        const LineIndex& idx,
+        const SuppressionTable& suppressions,
+        ScanResult& out
+    ) const;
+
+    void FindFormatStringIssues(
+        const std::filesystem::path& file_path,
+        const std::string& raw,
+        const std::string& sanitized,
+        const LineIndex& idx,
+        const SuppressionTable& suppressions,
+        const std::vector<size_t>& candidates,
         ScanResult& out
-    );
+    ) const;
 
-    void FindScanfUnsafePercentS(
+    void FindRegexIssues(
         const std::filesystem::path& file_path,
         const std::string& raw,
         const std::string& sanitized,
+        const LineIndex& idx,
+        const SuppressionTable& suppressions,
+        const std::vector<char>& candidates,
         ScanResult& out
-    );
+    ) const;
 
     static bool HasUnsafePercentS(const std::string& fmt);
+    static bool HasPercentN(const std::string& fmt);
 
     static std::string SeverityToString(Severity s);
 };
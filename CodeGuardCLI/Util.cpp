@@ -1,10 +1,17 @@
 #include "Util.h"
 
+#define NOMINMAX
 #include <windows.h>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 #include <cctype>
 
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CODEGUARD_HAS_SSE2 1
+#endif
+
 namespace codeguard
 {
 LineIndex LineIndex::Build(const std::string& text)
@@ -76,6 +83,72 @@ std::string_view LineIndex::LineText(const std::string& text, size_t line) const
     return std::string_view(text.data() + start, end - start);
 }
 
+bool SuppressionTable::Empty() const
+{
+    return markers.empty();
+}
+
+void SuppressionTable::Resolve(const LineIndex& idx)
+{
+    ranges.clear();
+
+    std::vector<Range> open;
+    for (const auto& m : markers)
+    {
+        const size_t line = idx.LineFromIndex(m.offset);
+        switch (m.kind)
+        {
+            case Kind::Line:
+                ranges.push_back({ line, line, m.rule_ids });
+                break;
+            case Kind::LineAndNext:
+                ranges.push_back({ line, line + 1, m.rule_ids });
+                break;
+            case Kind::Begin:
+                open.push_back({ line, 0, m.rule_ids });
+                break;
+            case Kind::End:
+                if (!open.empty())
+                {
+                    Range r = std::move(open.back());
+                    open.pop_back();
+                    r.last_line = line;
+                    ranges.push_back(std::move(r));
+                }
+                break;
+        }
+    }
+
+    for (auto& r : open)
+    {
+        r.last_line = static_cast<size_t>(-1);
+        ranges.push_back(std::move(r));
+    }
+}
+
+bool SuppressionTable::IsSuppressed(size_t line, const std::string& rule_id) const
+{
+    for (const auto& r : ranges)
+    {
+        if (line < r.first_line || line > r.last_line)
+        {
+            continue;
+        }
+        if (r.rule_ids.empty())
+        {
+            return true;
+        }
+        for (const auto& id : r.rule_ids)
+        {
+            if (id == rule_id)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 static std::string LTrim(const std::string& s)
 {
     size_t i = 0;
@@ -146,6 +219,44 @@ std::wstring ToWideFromConsoleInput(const std::string& s)
     return out;
 }
 
+std::string PathToUtf8(const std::filesystem::path& p)
+{
+    const auto s = p.u8string();
+    return std::string(s.begin(), s.end());
+}
+
+std::filesystem::path PathFromUtf8(const std::string& s)
+{
+#if defined(__cpp_char8_t)
+    return std::filesystem::path(std::u8string(s.begin(), s.end()));
+#else
+    return std::filesystem::u8path(s);
+#endif
+}
+
+std::string NormalizeRelativePath(const std::filesystem::path& p, const std::filesystem::path& root)
+{
+    std::filesystem::path rel = p.lexically_relative(root);
+    if (rel.empty())
+    {
+        rel = p;
+    }
+
+    std::string s = PathToUtf8(rel);
+    for (auto& c : s)
+    {
+        if (c == '\\')
+        {
+            c = '/';
+        }
+        else if (c >= 'A' && c <= 'Z')
+        {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return s;
+}
+
 bool IsLikelyTextFileExtension(const std::filesystem::path& p)
 {
     const auto ext = p.extension().wstring();
@@ -168,21 +279,191 @@ bool IsLikelyTextFileExtension(const std::filesystem::path& p)
     return e == L".c" || e == L".cc" || e == L".cpp" || e == L".cxx" || e == L".h" || e == L".hpp" || e == L".hh" || e == L".hxx" || e == L".inl";
 }
 
-bool ReadFileAll(const std::filesystem::path& p, std::string& out, std::string& err)
+static size_t CountBits(unsigned v)
+{
+    size_t n = 0;
+    while (v != 0)
+    {
+        v &= v - 1;
+        n++;
+    }
+    return n;
+}
+
+static void CountZeroBytes(const unsigned char* p, size_t n, size_t& even, size_t& odd)
+{
+    size_t i = 0;
+#if defined(CODEGUARD_HAS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+        if (mask != 0)
+        {
+            even += CountBits(mask & 0x5555u);
+            odd += CountBits(mask & 0xAAAAu);
+        }
+    }
+#endif
+    for (; i < n; i++)
+    {
+        if (p[i] == 0)
+        {
+            ((i & 1) ? odd : even)++;
+        }
+    }
+}
+
+TextEncoding DetectEncoding(std::string_view data, size_t& bom_size)
+{
+    bom_size = 0;
+    const auto* p = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t n = std::min(data.size(), kSniffBytes);
+
+    if (n >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
+    {
+        bom_size = 3;
+        return TextEncoding::Utf8;
+    }
+    if (n >= 2 && p[0] == 0xFF && p[1] == 0xFE)
+    {
+        bom_size = 2;
+        return TextEncoding::Utf16LE;
+    }
+    if (n >= 2 && p[0] == 0xFE && p[1] == 0xFF)
+    {
+        bom_size = 2;
+        return TextEncoding::Utf16BE;
+    }
+
+    size_t even = 0;
+    size_t odd = 0;
+    CountZeroBytes(p, n, even, odd);
+    if (even == 0 && odd == 0)
+    {
+        return TextEncoding::Utf8;
+    }
+
+    // BOM-less UTF-16 source is mostly ASCII, so one byte of every pair is zero.
+    const size_t pairs = n / 2;
+    if (odd * 10 >= pairs * 3 && even * 20 <= pairs)
+    {
+        return TextEncoding::Utf16LE;
+    }
+    if (even * 10 >= pairs * 3 && odd * 20 <= pairs)
+    {
+        return TextEncoding::Utf16BE;
+    }
+    return TextEncoding::Binary;
+}
+
+bool HasGeneratedMarker(std::string_view data)
+{
+    static const char* const kMarkers[] = {
+        "@generated",
+        "<auto-generated",
+        "DO NOT EDIT",
+        "Code generated by",
+        "Generated by the protocol buffer compiler",
+        "This file was automatically generated",
+        "Automatically generated by"
+    };
+
+    const std::string_view head = data.substr(0, std::min(data.size(), kSniffBytes));
+    if (head.find("enerated") == std::string_view::npos && head.find("EDIT") == std::string_view::npos)
+    {
+        return false;
+    }
+
+    for (const char* m : kMarkers)
+    {
+        if (head.find(m) != std::string_view::npos)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void AppendUtf8(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+std::string TranscodeUtf16ToUtf8(std::string_view data, bool big_endian)
+{
+    const auto* p = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t units = data.size() / 2;
+
+    const auto unitAt = [&](size_t i) -> uint32_t
+    {
+        const uint32_t a = p[i * 2];
+        const uint32_t b = p[i * 2 + 1];
+        return big_endian ? ((a << 8) | b) : ((b << 8) | a);
+    };
+
+    std::string out;
+    out.reserve(units);
+
+    for (size_t i = 0; i < units; i++)
+    {
+        uint32_t cp = unitAt(i);
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < units)
+        {
+            const uint32_t lo = unitAt(i + 1);
+            if (lo >= 0xDC00 && lo <= 0xDFFF)
+            {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                i++;
+            }
+            else
+            {
+                cp = 0xFFFD;
+            }
+        }
+        else if (cp >= 0xD800 && cp <= 0xDFFF)
+        {
+            cp = 0xFFFD;
+        }
+        AppendUtf8(out, cp);
+    }
+
+    return out;
+}
+
+bool ReadFileAll(const std::filesystem::path& p, std::string& out, std::string& err, uint64_t max_bytes)
 {
     out.clear();
     err.clear();
 
     std::error_code ec;
     const auto sz = std::filesystem::file_size(p, ec);
-    if (!ec)
+    if (!ec && sz > max_bytes)
     {
-        const uintmax_t maxBytes = 10ull * 1024ull * 1024ull;
-        if (sz > maxBytes)
-        {
-            err = "file too large";
-            return false;
-        }
+        err = "file too large";
+        return false;
     }
 
     std::ifstream f(p, std::ios::binary);
@@ -215,7 +496,148 @@ bool ReadFileAll(const std::filesystem::path& p, std::string& out, std::string&
     return true;
 }
 
-std::string SanitizeKeepLayout(const std::string& input)
+bool ReadFileHead(const std::filesystem::path& p, size_t max_bytes, std::string& out, uint64_t& file_size, std::string& err)
+{
+    out.clear();
+    err.clear();
+
+    std::error_code ec;
+    const auto sz = std::filesystem::file_size(p, ec);
+    if (ec)
+    {
+        err = "failed to determine file size";
+        return false;
+    }
+    if (sz > kMaxSourceBytes)
+    {
+        err = "file too large";
+        return false;
+    }
+    file_size = static_cast<uint64_t>(sz);
+
+    std::ifstream f(p, std::ios::binary);
+    if (!f)
+    {
+        err = "failed to open file";
+        return false;
+    }
+
+    out.resize(static_cast<size_t>(std::min<uint64_t>(file_size, max_bytes)));
+    if (!out.empty())
+    {
+        f.read(out.data(), static_cast<std::streamsize>(out.size()));
+        out.resize(static_cast<size_t>(f.gcount()));
+    }
+    return true;
+}
+
+static bool LineHasCodeBefore(const std::string& input, size_t pos)
+{
+    while (pos > 0)
+    {
+        const char c = input[pos - 1];
+        if (c == '\n')
+        {
+            return false;
+        }
+        if (c != ' ' && c != '\t' && c != '\r')
+        {
+            return true;
+        }
+        pos--;
+    }
+    return false;
+}
+
+static bool IsRuleIdToken(const std::string& input, size_t start, size_t end, const SuppressionTable& table)
+{
+    if (end - start > 2 && input.compare(start, 2, "CG") == 0
+        && std::all_of(input.begin() + static_cast<std::ptrdiff_t>(start + 2), input.begin() + static_cast<std::ptrdiff_t>(end), [](char c) { return c >= '0' && c <= '9'; }))
+    {
+        return true;
+    }
+    return table.user_rule_ids != nullptr && table.user_rule_ids->count(input.substr(start, end - start)) != 0;
+}
+
+// Called once per comment opener; body is the offset right after "//" or "/*".
+// Only rule ids are collected; "--" ends the id list, so "codeguard-ignore: legacy code" suppresses every rule.
+static void ParseSuppressionMarker(const std::string& input, size_t comment_start, size_t body, bool block, SuppressionTable& table)
+{
+    static const char kMarker[] = "codeguard-ignore";
+    const size_t markerLen = sizeof(kMarker) - 1;
+
+    size_t i = body;
+    while (i < input.size() && (input[i] == ' ' || input[i] == '\t'))
+    {
+        i++;
+    }
+    if (input.compare(i, markerLen, kMarker) != 0)
+    {
+        return;
+    }
+    i += markerLen;
+
+    SuppressionTable::Marker m;
+    m.offset = comment_start;
+    if (input.compare(i, 6, "-begin") == 0)
+    {
+        m.kind = SuppressionTable::Kind::Begin;
+        i += 6;
+    }
+    else if (input.compare(i, 4, "-end") == 0)
+    {
+        m.kind = SuppressionTable::Kind::End;
+        i += 4;
+    }
+    else
+    {
+        m.kind = LineHasCodeBefore(input, comment_start) ? SuppressionTable::Kind::Line : SuppressionTable::Kind::LineAndNext;
+        // A block comment covers the line where it ends and the one after that.
+        if (block && m.kind == SuppressionTable::Kind::LineAndNext)
+        {
+            const size_t close = input.find("*/", body);
+            if (close != std::string::npos)
+            {
+                m.offset = close;
+            }
+        }
+    }
+
+    if (i < input.size() && IsIdentChar(static_cast<unsigned char>(input[i])))
+    {
+        return;
+    }
+
+    while (i < input.size() && input[i] != '\n')
+    {
+        if (block && input[i] == '*' && i + 1 < input.size() && input[i + 1] == '/')
+        {
+            break;
+        }
+        if (input[i] == '-' && i + 1 < input.size() && input[i + 1] == '-')
+        {
+            break;
+        }
+        if (!IsIdentChar(static_cast<unsigned char>(input[i])))
+        {
+            i++;
+            continue;
+        }
+        const size_t start = i;
+        while (i < input.size() && IsIdentChar(static_cast<unsigned char>(input[i])))
+        {
+            i++;
+        }
+        if (IsRuleIdToken(input, start, i, table))
+        {
+            m.rule_ids.emplace_back(input, start, i - start);
+        }
+    }
+
+    table.markers.push_back(std::move(m));
+}
+
+std::string SanitizeKeepLayout(const std::string& input, SuppressionTable* suppressions)
 {
     enum class State
     {
@@ -241,6 +663,10 @@ std::string SanitizeKeepLayout(const std::string& input)
         {
             if (c == '/' && n == '/')
             {
+                if (suppressions != nullptr)
+                {
+                    ParseSuppressionMarker(input, i, i + 2, false, *suppressions);
+                }
                 out[i] = ' ';
                 out[i + 1] = ' ';
                 i++;
@@ -249,6 +675,10 @@ std::string SanitizeKeepLayout(const std::string& input)
             }
             if (c == '/' && n == '*')
             {
+                if (suppressions != nullptr)
+                {
+                    ParseSuppressionMarker(input, i, i + 2, true, *suppressions);
+                }
                 out[i] = ' ';
                 out[i + 1] = ' ';
                 i++;
@@ -392,4 +822,80 @@ bool IsIdentChar(unsigned char c)
 {
     return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
 }
+
+uint64_t HashBytes(std::string_view data, uint64_t seed)
+{
+    uint64_t h = 14695981039346656037ull ^ seed;
+    for (const char c : data)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= 1099511628211ull;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+void AppendU32(std::string& out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+}
+
+void AppendU64(std::string& out, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+    }
+}
+
+uint64_t LoadLE(const unsigned char* p, int bytes)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        v |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return v;
+}
+
+std::string JsonEscape(std::string_view s)
+{
+    static const char kHex[] = "0123456789abcdef";
+
+    std::string out;
+    out.reserve(s.size() + 8);
+    for (const char ch : s)
+    {
+        const unsigned char c = static_cast<unsigned char>(ch);
+        switch (c)
+        {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20)
+                {
+                    out += "\\u00";
+                    out.push_back(kHex[c >> 4]);
+                    out.push_back(kHex[c & 0xf]);
+                }
+                else
+                {
+                    out.push_back(ch);
+                }
+                break;
+        }
+    }
+    return out;
+}
 }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 #include <filesystem>
 
@@ -17,16 +20,85 @@ struct LineIndex
     std::string_view LineText(const std::string& text, size_t line) const;
 };
 
+struct SuppressionTable
+{
+    enum class Kind
+    {
+        Line,
+        LineAndNext,
+        Begin,
+        End
+    };
+
+    struct Marker
+    {
+        Kind kind;
+        size_t offset;
+        std::vector<std::string> rule_ids;
+    };
+
+    struct Range
+    {
+        size_t first_line;
+        size_t last_line;
+        std::vector<std::string> rule_ids;
+    };
+
+    std::vector<Marker> markers;
+    std::vector<Range> ranges;
+    // Besides CGnnnn, the rule ids a marker may name; any other word is a free-text reason.
+    const std::unordered_set<std::string>* user_rule_ids = nullptr;
+
+    bool Empty() const;
+    void Resolve(const LineIndex& idx);
+    bool IsSuppressed(size_t line, const std::string& rule_id) const;
+};
+
 std::string Trim(const std::string& s);
 std::string StripQuotes(const std::string& s);
 
 std::wstring ToWideFromConsoleInput(const std::string& s);
 
+std::string PathToUtf8(const std::filesystem::path& p);
+std::filesystem::path PathFromUtf8(const std::string& s);
+
+// Root-relative, '/'-separated, ASCII lower-cased; stable key for a file across scans.
+std::string NormalizeRelativePath(const std::filesystem::path& p, const std::filesystem::path& root);
+
 bool IsLikelyTextFileExtension(const std::filesystem::path& p);
 
-bool ReadFileAll(const std::filesystem::path& p, std::string& out, std::string& err);
+enum class TextEncoding
+{
+    Utf8,
+    Utf16LE,
+    Utf16BE,
+    Binary
+};
+
+// Inspects only the first kSniffBytes of data.
+constexpr size_t kSniffBytes = 4096;
+
+TextEncoding DetectEncoding(std::string_view data, size_t& bom_size);
+bool HasGeneratedMarker(std::string_view data);
+std::string TranscodeUtf16ToUtf8(std::string_view data, bool big_endian);
+
+// Source files above this size are refused; the tool's own data files pass a larger limit.
+constexpr uint64_t kMaxSourceBytes = 10ull * 1024ull * 1024ull;
 
-std::string SanitizeKeepLayout(const std::string& input);
+bool ReadFileAll(const std::filesystem::path& p, std::string& out, std::string& err, uint64_t max_bytes = kMaxSourceBytes);
+// Reads at most max_bytes from the start of p; file_size receives the full size.
+bool ReadFileHead(const std::filesystem::path& p, size_t max_bytes, std::string& out, uint64_t& file_size, std::string& err);
+
+// Blanks comments and literals; when suppressions is given, codeguard-ignore markers found in comments are recorded.
+std::string SanitizeKeepLayout(const std::string& input, SuppressionTable* suppressions = nullptr);
 
 bool IsIdentChar(unsigned char c);
+
+std::string JsonEscape(std::string_view s);
+
+uint64_t HashBytes(std::string_view data, uint64_t seed);
+
+void AppendU32(std::string& out, uint32_t v);
+void AppendU64(std::string& out, uint64_t v);
+uint64_t LoadLE(const unsigned char* p, int bytes);
 }
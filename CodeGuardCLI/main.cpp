@@ -1,9 +1,43 @@
 #include <iostream>
 #include <filesystem>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
 
 #include "Scanner.h"
 #include "Util.h"
+#include "Baseline.h"
+#include "History.h"
+#include "Results.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "CallIndex.h"
+#include "Checkpoint.h"
+#include "RegexRules.h"
+
+struct CliOptions
+{
+    std::filesystem::path root;
+    std::filesystem::path baseline_path;
+    std::filesystem::path write_baseline_path;
+    std::filesystem::path history_path;
+    std::filesystem::path call_index_path;
+    std::filesystem::path checkpoint_path;
+    std::filesystem::path rules_path;
+    bool resume;
+    codeguard::RunOptions run;
+    codeguard::GeneratedFilePolicy generated_files;
+    bool scan_archives;
+    bool printf_percent_n;
+    std::filesystem::path results_path;
+    std::filesystem::path diff_old_path;
+    std::filesystem::path diff_new_path;
+    bool json;
+    std::filesystem::path metrics_path;
+    uint16_t metrics_port;
+    uint64_t interval_seconds;
+};
 
 static void PrintBanner()
 {
@@ -12,10 +46,71 @@ static void PrintBanner()
     std::cout << ">" << std::endl;
 }
 
-static std::filesystem::path ReadRootPath()
+static void PrintUsage()
+{
+    std::cout << "Usage: CodeGuardCLI [options] [root]" << std::endl;
+    std::cout << "  --baseline <file>        suppress findings recorded in baseline file" << std::endl;
+    std::cout << "  --write-baseline <file>  write current findings as baseline file" << std::endl;
+    std::cout << "  --threads <n>            worker threads (default: all cores)" << std::endl;
+    std::cout << "  --fail-fast              stop at the first finding" << std::endl;
+    std::cout << "  --fail-on <low|med|high> stop at the first finding of at least this severity" << std::endl;
+    std::cout << "  --max-findings <n>       stop after n findings" << std::endl;
+    std::cout << "  --history <file>         scan files with past findings first and update the history" << std::endl;
+    std::cout << "  --call-index <file>      report calls to wrappers that reach banned functions; index is kept in file" << std::endl;
+    std::cout << "  --rules <file>           add regex rules from file (<id> <low|med|high> <code|text> <pattern> per line)" << std::endl;
+    std::cout << "  --checkpoint <file>      record completed files so an interrupted scan can be resumed" << std::endl;
+    std::cout << "  --resume                 continue from the --checkpoint file instead of starting over" << std::endl;
+    std::cout << "  --generated <scan|skip|defer>  handling of files marked as generated (default: scan)" << std::endl;
+    std::cout << "  --results <file>         also write findings to a binary result file" << std::endl;
+    std::cout << "  --diff <old> <new>       compare two result files instead of scanning" << std::endl;
+    std::cout << "  --format <text|json>     output format for --diff (default: text)" << std::endl;
+    std::cout << "  --printf-n               also report %n in printf-family formats (CG0003)" << std::endl;
+    std::cout << "  --archives               scan inside .tar/.tar.gz/.tgz files without extracting" << std::endl;
+    std::cout << "  --metrics-file <file>    write Prometheus metrics after each scan" << std::endl;
+    std::cout << "  --metrics-port <port>    serve Prometheus metrics on 127.0.0.1:<port>/metrics while running" << std::endl;
+    std::cout << "  --interval <seconds>     rescan repeatedly with this pause until interrupted" << std::endl;
+}
+
+static bool ParseSeverity(const std::string& s, codeguard::Severity& out)
+{
+    if (s == "low")
+    {
+        out = codeguard::Severity::Low;
+        return true;
+    }
+    if (s == "med" || s == "medium")
+    {
+        out = codeguard::Severity::Medium;
+        return true;
+    }
+    if (s == "high")
+    {
+        out = codeguard::Severity::High;
+        return true;
+    }
+    return false;
+}
+
+static bool ParseCount(const std::string& s, uint64_t& out)
+{
+    if (s.empty() || s.size() > 18)
+    {
+        return false;
+    }
+    out = 0;
+    for (const char c : s)
+    {
+        if (c < '0' || c > '9')
+        {
+            return false;
+        }
+        out = out * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return true;
+}
+
+static std::filesystem::path PathFromInput(std::string line)
 {
-    std::string line;
-    std::getline(std::cin, line);
     line = codeguard::Trim(line);
     line = codeguard::StripQuotes(line);
 
@@ -28,10 +123,167 @@ static std::filesystem::path ReadRootPath()
     return std::filesystem::path(line);
 }
 
+static std::filesystem::path ReadRootPath()
+{
+    std::string line;
+    std::getline(std::cin, line);
+    return PathFromInput(line);
+}
+
+static bool ParseArgs(int argc, char** argv, CliOptions& cli)
+{
+    cli.run = { 0, 0, false, codeguard::Severity::High };
+    cli.generated_files = codeguard::GeneratedFilePolicy::Scan;
+    cli.scan_archives = false;
+    cli.printf_percent_n = false;
+    cli.json = false;
+    cli.resume = false;
+    cli.metrics_port = 0;
+    cli.interval_seconds = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (arg == "--baseline" && hasValue)
+        {
+            cli.baseline_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--write-baseline" && hasValue)
+        {
+            cli.write_baseline_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--history" && hasValue)
+        {
+            cli.history_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--call-index" && hasValue)
+        {
+            cli.call_index_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--rules" && hasValue)
+        {
+            cli.rules_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--checkpoint" && hasValue)
+        {
+            cli.checkpoint_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--resume")
+        {
+            cli.resume = true;
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            uint64_t n = 0;
+            if (!ParseCount(argv[++i], n) || n > 1024)
+            {
+                return false;
+            }
+            cli.run.threads = static_cast<uint32_t>(n);
+        }
+        else if (arg == "--fail-fast")
+        {
+            cli.run.max_findings = 1;
+        }
+        else if (arg == "--fail-on" && hasValue)
+        {
+            if (!ParseSeverity(argv[++i], cli.run.stop_severity))
+            {
+                return false;
+            }
+            cli.run.stop_on_severity = true;
+        }
+        else if (arg == "--max-findings" && hasValue)
+        {
+            if (!ParseCount(argv[++i], cli.run.max_findings))
+            {
+                return false;
+            }
+        }
+        else if (arg == "--results" && hasValue)
+        {
+            cli.results_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--diff" && i + 2 < argc)
+        {
+            cli.diff_old_path = PathFromInput(argv[++i]);
+            cli.diff_new_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--format" && hasValue)
+        {
+            const std::string v = argv[++i];
+            if (v != "text" && v != "json")
+            {
+                return false;
+            }
+            cli.json = (v == "json");
+        }
+        else if (arg == "--metrics-file" && hasValue)
+        {
+            cli.metrics_path = PathFromInput(argv[++i]);
+        }
+        else if (arg == "--metrics-port" && hasValue)
+        {
+            uint64_t port = 0;
+            if (!ParseCount(argv[++i], port) || port == 0 || port > 65535)
+            {
+                return false;
+            }
+            cli.metrics_port = static_cast<uint16_t>(port);
+        }
+        else if (arg == "--interval" && hasValue)
+        {
+            if (!ParseCount(argv[++i], cli.interval_seconds) || cli.interval_seconds == 0)
+            {
+                return false;
+            }
+        }
+        else if (arg == "--archives")
+        {
+            cli.scan_archives = true;
+        }
+        else if (arg == "--printf-n")
+        {
+            cli.printf_percent_n = true;
+        }
+        else if (arg == "--generated" && hasValue)
+        {
+            const std::string v = argv[++i];
+            if (v == "scan")
+            {
+                cli.generated_files = codeguard::GeneratedFilePolicy::Scan;
+            }
+            else if (v == "skip")
+            {
+                cli.generated_files = codeguard::GeneratedFilePolicy::Skip;
+            }
+            else if (v == "defer")
+            {
+                cli.generated_files = codeguard::GeneratedFilePolicy::Defer;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if (!arg.empty() && arg[0] != '-' && cli.root.empty())
+        {
+            cli.root = PathFromInput(arg);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return !cli.resume || !cli.checkpoint_path.empty();
+}
+
 static void PrintFinding(const codeguard::Finding& f)
 {
     std::cout
-        << f.file_path.u8string()
+        << codeguard::PathToUtf8(f.file_path)
         << ":" << f.line
         << ":" << f.column
         << " [" << f.rule_id << "] "
@@ -53,39 +305,369 @@ static void PrintFinding(const codeguard::Finding& f)
     }
 }
 
-int main()
+static const char* DiffKindName(codeguard::DiffKind k)
 {
-    PrintBanner();
+    switch (k)
+    {
+        case codeguard::DiffKind::Introduced: return "introduced";
+        case codeguard::DiffKind::Fixed: return "fixed";
+        case codeguard::DiffKind::Moved: return "moved";
+        default: return "unchanged";
+    }
+}
 
-    const auto root = ReadRootPath();
+static int RunDiff(const CliOptions& cli)
+{
+    bool first = true;
+    if (cli.json)
+    {
+        std::cout << "{\"changes\":[";
+    }
 
-    std::error_code ec;
-    if (root.empty() || !std::filesystem::exists(root, ec) || !std::filesystem::is_directory(root, ec))
+    codeguard::DiffSummary summary;
+    std::string err;
+    const bool ok = codeguard::DiffResultFiles(
+        cli.diff_old_path,
+        cli.diff_new_path,
+        [&](codeguard::DiffKind kind, const codeguard::ResultRecord* a, const codeguard::ResultRecord* b)
+        {
+            if (kind == codeguard::DiffKind::Unchanged)
+            {
+                return;
+            }
+
+            const codeguard::ResultRecord& r = (b != nullptr) ? *b : *a;
+            if (cli.json)
+            {
+                std::cout
+                    << (first ? "" : ",")
+                    << "\n{\"change\":\"" << DiffKindName(kind) << "\""
+                    << ",\"rule_id\":\"" << codeguard::JsonEscape(r.rule_id) << "\""
+                    << ",\"path\":\"" << codeguard::JsonEscape(r.path) << "\""
+                    << ",\"line\":" << r.line
+                    << ",\"column\":" << r.column;
+                if (kind == codeguard::DiffKind::Moved)
+                {
+                    std::cout << ",\"old_line\":" << a->line;
+                }
+                std::cout
+                    << ",\"message\":\"" << codeguard::JsonEscape(r.message) << "\""
+                    << ",\"line_text\":\"" << codeguard::JsonEscape(r.line_text) << "\"}";
+                first = false;
+                return;
+            }
+
+            const char mark = (kind == codeguard::DiffKind::Introduced) ? '+' : (kind == codeguard::DiffKind::Fixed) ? '-' : '~';
+            std::cout << mark << " " << r.path << ":";
+            if (kind == codeguard::DiffKind::Moved)
+            {
+                std::cout << a->line << "->";
+            }
+            std::cout << r.line << ":" << r.column << " [" << r.rule_id << "] " << r.message << "\n";
+        },
+        summary,
+        err
+    );
+
+    // Changes are streamed, so with JSON output the error closes the same object instead of following it.
+    if (!ok)
     {
-        std::cout << "Invalid directory." << std::endl;
+        if (cli.json)
+        {
+            std::cout << "\n],\"error\":\"" << codeguard::JsonEscape(err) << "\"}" << std::endl;
+        }
+        else
+        {
+            std::cout << "Diff error: " << err << std::endl;
+        }
         return 2;
     }
 
+    if (cli.json)
+    {
+        std::cout
+            << "\n],\"summary\":{\"introduced\":" << summary.introduced
+            << ",\"fixed\":" << summary.fixed
+            << ",\"moved\":" << summary.moved
+            << ",\"unchanged\":" << summary.unchanged
+            << "}}" << std::endl;
+    }
+    else
+    {
+        std::cout << std::endl;
+        std::cout << "Introduced: " << summary.introduced << std::endl;
+        std::cout << "Fixed: " << summary.fixed << std::endl;
+        std::cout << "Moved: " << summary.moved << std::endl;
+        std::cout << "Unchanged: " << summary.unchanged << std::endl;
+    }
+
+    return (summary.introduced > 0) ? 1 : 0;
+}
+
+static int ScanOnce(const CliOptions& cli, codeguard::ScanMetrics* metrics)
+{
+    const auto& root = cli.root;
+    std::error_code ec;
+
     codeguard::Scanner scanner;
     scanner.SetRoot(root);
+    scanner.SetMetrics(metrics);
 
     codeguard::ScanOptions opt;
     opt.check_banned_functions = true;
     opt.check_scanf_unsafe_percent_s = true;
+    opt.check_printf_percent_n = cli.printf_percent_n;
+    opt.generated_files = cli.generated_files;
+    opt.scan_archives = cli.scan_archives;
     scanner.SetOptions(opt);
+    scanner.SetRunOptions(cli.run);
+
+    codeguard::RegexRuleSet regexRules;
+    if (!cli.rules_path.empty())
+    {
+        std::string err;
+        std::vector<codeguard::RegexRule> rules;
+        if (!codeguard::RegexRuleSet::LoadFile(cli.rules_path, rules, err) || !regexRules.Compile(rules, err))
+        {
+            std::cout << "Rules error: " << err << std::endl;
+            return 2;
+        }
+        scanner.SetRegexRules(&regexRules);
+    }
+
+    codeguard::Baseline baseline;
+    if (!cli.baseline_path.empty() && cli.write_baseline_path.empty())
+    {
+        std::string err;
+        if (!baseline.Load(cli.baseline_path, err))
+        {
+            std::cout << "Baseline error: " << err << std::endl;
+            return 2;
+        }
+        scanner.SetBaseline(&baseline);
+    }
+
+    codeguard::ScanHistory history;
+    if (!cli.history_path.empty())
+    {
+        std::string err;
+        if (std::filesystem::exists(cli.history_path, ec) && !history.Load(cli.history_path, err))
+        {
+            std::cout << "History error: " << err << std::endl;
+            return 2;
+        }
+        scanner.SetHistory(&history);
+    }
+
+    codeguard::CallIndex callIndex;
+    if (!cli.call_index_path.empty())
+    {
+        std::string err;
+        if (std::filesystem::exists(cli.call_index_path, ec) && !callIndex.Load(cli.call_index_path, err))
+        {
+            std::cout << "Call index error: " << err << std::endl;
+            return 2;
+        }
+        scanner.SetCallIndex(&callIndex);
+    }
+
+    codeguard::ScanCheckpoint checkpoint;
+    if (!cli.checkpoint_path.empty())
+    {
+        std::string err;
+        if (!checkpoint.Open(cli.checkpoint_path, scanner.RunSignature(), cli.resume, err))
+        {
+            std::cout << "Checkpoint error: " << err << std::endl;
+            return 2;
+        }
+        scanner.SetCheckpoint(&checkpoint);
+    }
 
     const auto result = scanner.Run();
 
+    // A finished scan no longer needs its checkpoint; the next run starts over.
+    if (!cli.checkpoint_path.empty() && !result.stopped_early)
+    {
+        checkpoint.Close();
+        std::filesystem::remove(cli.checkpoint_path, ec);
+    }
+
+    if (!cli.history_path.empty())
+    {
+        std::string err;
+        if (!history.Save(cli.history_path, err))
+        {
+            std::cout << "History error: " << err << std::endl;
+        }
+    }
+
+    if (!cli.call_index_path.empty())
+    {
+        std::string err;
+        if (!callIndex.Save(cli.call_index_path, err))
+        {
+            std::cout << "Call index error: " << err << std::endl;
+        }
+    }
+
+    if (!cli.write_baseline_path.empty())
+    {
+        std::vector<uint64_t> fingerprints;
+        fingerprints.reserve(result.findings.size());
+        for (const auto& f : result.findings)
+        {
+            fingerprints.push_back(codeguard::FindingFingerprint(f, root));
+        }
+
+        std::string err;
+        if (!codeguard::Baseline::Write(cli.write_baseline_path, std::move(fingerprints), err))
+        {
+            std::cout << "Baseline error: " << err << std::endl;
+            return 2;
+        }
+        std::cout << "Baseline written: " << result.findings.size() << " findings" << std::endl;
+        return 0;
+    }
+
     for (const auto& f : result.findings)
     {
         PrintFinding(f);
     }
 
+    if (!cli.results_path.empty())
+    {
+        std::string err;
+        if (!codeguard::WriteResultFile(cli.results_path, result, root, err))
+        {
+            std::cout << "Results error: " << err << std::endl;
+        }
+    }
+
     std::cout << std::endl;
     std::cout << "Files seen: " << result.stats.files_seen << std::endl;
     std::cout << "Files scanned: " << result.stats.files_scanned << std::endl;
     std::cout << "Bytes scanned: " << result.stats.bytes_scanned << std::endl;
     std::cout << "Findings: " << result.stats.findings << std::endl;
+    if (result.stats.files_prefiltered > 0)
+    {
+        std::cout << "Prefiltered (no candidates): " << result.stats.files_prefiltered << std::endl;
+    }
+    if (checkpoint.Restored() > 0)
+    {
+        std::cout << "Resumed from checkpoint: " << checkpoint.Restored() << " files" << std::endl;
+    }
+    if (!cli.call_index_path.empty())
+    {
+        std::cout << "Call index: " << callIndex.Size() << " files (" << callIndex.Reindexed() << " re-indexed)" << std::endl;
+    }
+    if (result.stats.files_binary > 0)
+    {
+        std::cout << "Binary skipped: " << result.stats.files_binary << std::endl;
+    }
+    if (result.stats.files_utf16 > 0)
+    {
+        std::cout << "UTF-16 transcoded: " << result.stats.files_utf16 << std::endl;
+    }
+    if (result.stats.archives_scanned > 0)
+    {
+        std::cout << "Archives scanned: " << result.stats.archives_scanned << std::endl;
+    }
+    if (result.stats.archives_unreadable > 0)
+    {
+        std::cout << "Archives unreadable (truncated or corrupt): " << result.stats.archives_unreadable << std::endl;
+    }
+    if (result.stats.files_generated > 0)
+    {
+        std::cout << "Generated: " << result.stats.files_generated << std::endl;
+    }
+    if (result.stats.findings_suppressed > 0)
+    {
+        std::cout << "Suppressed: " << result.stats.findings_suppressed << std::endl;
+    }
+    if (!cli.baseline_path.empty())
+    {
+        std::cout << "Baselined: " << result.stats.findings_baselined << std::endl;
+    }
+
+    if (result.stopped_early)
+    {
+        std::cout << "Stopped early: yes" << std::endl;
+    }
+
+    if (cli.run.stop_on_severity)
+    {
+        for (const auto& f : result.findings)
+        {
+            if (static_cast<int>(f.severity) >= static_cast<int>(cli.run.stop_severity))
+            {
+                return 1;
+            }
+        }
+        return 0;
+    }
 
     return (result.stats.findings > 0) ? 1 : 0;
 }
+
+int main(int argc, char** argv)
+{
+    CliOptions cli;
+    if (!ParseArgs(argc, argv, cli))
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    if (!cli.diff_old_path.empty())
+    {
+        return RunDiff(cli);
+    }
+
+    if (cli.root.empty())
+    {
+        PrintBanner();
+        cli.root = ReadRootPath();
+    }
+
+    std::error_code ec;
+    if (cli.root.empty() || !std::filesystem::exists(cli.root, ec) || !std::filesystem::is_directory(cli.root, ec))
+    {
+        std::cout << "Invalid directory." << std::endl;
+        return 2;
+    }
+
+    codeguard::ScanMetrics metrics;
+    const bool metricsEnabled = !cli.metrics_path.empty() || cli.metrics_port != 0;
+
+    codeguard::MetricsServer server;
+    if (cli.metrics_port != 0)
+    {
+        std::string err;
+        if (!server.Start(cli.metrics_port, metrics, err))
+        {
+            std::cout << "Metrics error: " << err << std::endl;
+            return 2;
+        }
+    }
+
+    for (;;)
+    {
+        const int code = ScanOnce(cli, metricsEnabled ? &metrics : nullptr);
+
+        if (!cli.metrics_path.empty())
+        {
+            std::string err;
+            if (!metrics.WriteFile(cli.metrics_path, err))
+            {
+                std::cout << "Metrics error: " << err << std::endl;
+            }
+        }
+
+        if (cli.interval_seconds == 0 || code == 2)
+        {
+            return code;
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(cli.interval_seconds));
+    }
+}
@@ -0,0 +1,126 @@
+#include "CodeGuardApi.h"
+
+#include "../CodeGuardCLI/Scanner.h"
+#include "../CodeGuardCLI/Util.h"
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+// Size of cg_scan_options in API version 1; every caller passes at least these fields.
+static constexpr size_t kScanOptionsV1Size = offsetof(cg_scan_options, check_scanf_unsafe_percent_s) + sizeof(int);
+static constexpr size_t kScanOptionsV2Size = offsetof(cg_scan_options, check_printf_percent_n) + sizeof(int);
+
+struct cg_scanner
+{
+    codeguard::Scanner scanner;
+};
+
+static cg_severity ToCSeverity(codeguard::Severity s)
+{
+    switch (s)
+    {
+        case codeguard::Severity::Low: return CG_SEVERITY_LOW;
+        case codeguard::Severity::Medium: return CG_SEVERITY_MEDIUM;
+        case codeguard::Severity::High: return CG_SEVERITY_HIGH;
+        default: return CG_SEVERITY_LOW;
+    }
+}
+
+extern "C"
+{
+int cg_api_version(void)
+{
+    return CODEGUARD_API_VERSION;
+}
+
+cg_scanner* cg_scanner_create(void)
+{
+    try
+    {
+        return new cg_scanner();
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void cg_scanner_destroy(cg_scanner* scanner)
+{
+    delete scanner;
+}
+
+cg_status cg_scanner_set_options(cg_scanner* scanner, const cg_scan_options* options)
+{
+    if (scanner == nullptr || options == nullptr || options->struct_size < kScanOptionsV1Size)
+    {
+        return CG_ERROR_INVALID_ARGUMENT;
+    }
+
+    codeguard::ScanOptions opt;
+    opt.check_banned_functions = options->check_banned_functions != 0;
+    opt.check_scanf_unsafe_percent_s = options->check_scanf_unsafe_percent_s != 0;
+    opt.check_printf_percent_n = options->struct_size >= kScanOptionsV2Size && options->check_printf_percent_n != 0;
+    opt.generated_files = codeguard::GeneratedFilePolicy::Scan;
+    opt.scan_archives = false;
+    scanner->scanner.SetOptions(opt);
+    return CG_OK;
+}
+
+cg_status cg_scan_buffer(
+    const cg_scanner* scanner,
+    const char* virtual_path,
+    const char* data,
+    size_t size,
+    cg_finding_callback callback,
+    void* user_data,
+    uint64_t* out_findings
+)
+{
+    if (scanner == nullptr || (data == nullptr && size > 0))
+    {
+        return CG_ERROR_INVALID_ARGUMENT;
+    }
+
+    try
+    {
+        const std::string name = (virtual_path != nullptr) ? std::string(virtual_path) : std::string();
+        const std::string_view text = (size > 0) ? std::string_view(data, size) : std::string_view();
+
+        const auto stats = scanner->scanner.ScanBuffer(
+            codeguard::PathFromUtf8(name),
+            text,
+            [&](const codeguard::Finding& f)
+            {
+                if (callback == nullptr)
+                {
+                    return;
+                }
+
+                const std::string path = codeguard::PathToUtf8(f.file_path);
+
+                cg_finding cf;
+                cf.file_path = path.c_str();
+                cf.line = f.line;
+                cf.column = f.column;
+                cf.rule_id = f.rule_id.c_str();
+                cf.severity = ToCSeverity(f.severity);
+                cf.message = f.message.c_str();
+                cf.line_text = f.line_text.c_str();
+                callback(&cf, user_data);
+            }
+        );
+
+        if (out_findings != nullptr)
+        {
+            *out_findings = stats.findings;
+        }
+        return CG_OK;
+    }
+    catch (...)
+    {
+        return CG_ERROR_INTERNAL;
+    }
+}
+}
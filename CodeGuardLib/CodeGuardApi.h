@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(CODEGUARD_BUILD_DLL)
+#define CODEGUARD_API __declspec(dllexport)
+#elif defined(CODEGUARD_USE_DLL)
+#define CODEGUARD_API __declspec(dllimport)
+#else
+#define CODEGUARD_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CODEGUARD_API_VERSION 2
+
+typedef struct cg_scanner cg_scanner;
+
+typedef enum cg_status
+{
+    CG_OK = 0,
+    CG_ERROR_INVALID_ARGUMENT = 1,
+    CG_ERROR_INTERNAL = 2
+} cg_status;
+
+typedef enum cg_severity
+{
+    CG_SEVERITY_LOW = 0,
+    CG_SEVERITY_MEDIUM = 1,
+    CG_SEVERITY_HIGH = 2
+} cg_severity;
+
+// Callers set struct_size to sizeof(cg_scan_options); fields added later are only read when they fit,
+// so a caller built against an older header keeps working.
+typedef struct cg_scan_options
+{
+    size_t struct_size;
+    int check_banned_functions;
+    int check_scanf_unsafe_percent_s;
+    // Added in API version 2: report %n in printf-family formats (CG0003). Off when struct_size does not cover it.
+    int check_printf_percent_n;
+} cg_scan_options;
+
+// All strings are UTF-8 and only valid for the duration of the callback.
+typedef struct cg_finding
+{
+    const char* file_path;
+    size_t line;
+    size_t column;
+    const char* rule_id;
+    cg_severity severity;
+    const char* message;
+    const char* line_text;
+} cg_finding;
+
+typedef void (*cg_finding_callback)(const cg_finding* finding, void* user_data);
+
+CODEGUARD_API int cg_api_version(void);
+
+CODEGUARD_API cg_scanner* cg_scanner_create(void);
+CODEGUARD_API void cg_scanner_destroy(cg_scanner* scanner);
+
+// Not thread-safe with respect to concurrent cg_scan_buffer calls on the same scanner.
+CODEGUARD_API cg_status cg_scanner_set_options(cg_scanner* scanner, const cg_scan_options* options);
+
+// Thread-safe: one scanner may serve many threads at once.
+CODEGUARD_API cg_status cg_scan_buffer(
+    const cg_scanner* scanner,
+    const char* virtual_path,
+    const char* data,
+    size_t size,
+    cg_finding_callback callback,
+    void* user_data,
+    uint64_t* out_findings
+);
+
+#ifdef __cplusplus
+}
+#endif